@@ -0,0 +1,121 @@
+#pragma once
+
+// Utilitários compartilhados pelos benchmarks do autopatch_core (executáveis de console;
+// os tamanhos padrão são os dos pedidos e podem ser reduzidos pela linha de comando)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace autopatch::bench
+{
+
+    class Timer
+    {
+    public:
+        Timer() : m_start(std::chrono::steady_clock::now()) {}
+
+        double Seconds() const
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    // Argumento numérico 'index' (1 = primeiro) ou 'fallback'
+    inline uint64_t ArgOr(int argc, char **argv, int index, uint64_t fallback)
+    {
+        if (index < argc)
+        {
+            uint64_t value = std::strtoull(argv[index], nullptr, 10);
+            if (value > 0)
+            {
+                return value;
+            }
+        }
+        return fallback;
+    }
+
+    // Diretório temporário vazio e exclusivo do benchmark
+    inline std::filesystem::path TempDir(const std::string &name)
+    {
+        std::error_code ec;
+        std::filesystem::path dir = std::filesystem::temp_directory_path(ec) / ("autopatch_" + name);
+        std::filesystem::remove_all(dir, ec);
+        std::filesystem::create_directories(dir, ec);
+        return dir;
+    }
+
+    inline void RemoveDir(const std::filesystem::path &dir)
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    // Dados pseudoaleatórios (não comprimem)
+    inline std::vector<uint8_t> RandomBytes(size_t size, uint64_t seed)
+    {
+        std::vector<uint8_t> data(size);
+        uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+        for (size_t i = 0; i < size; i++)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            data[i] = static_cast<uint8_t>(state >> 24);
+        }
+        return data;
+    }
+
+    // Dados comprimíveis (~3-4x com zlib), parecidos com os textos e tabelas do cliente
+    inline std::vector<uint8_t> TextBytes(size_t size, uint64_t seed)
+    {
+        static const char *const WORDS[] = {"sprite", "monster", "item", "effect", "map", "npc",
+                                            "0", "12", "255", "texture", "\t", "\n", ",", "data"};
+        std::vector<uint8_t> data;
+        data.reserve(size + 16);
+        uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+        while (data.size() < size)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            const char *word = WORDS[state % (sizeof(WORDS) / sizeof(WORDS[0]))];
+            data.insert(data.end(), word, word + strlen(word));
+            data.push_back(' ');
+        }
+        data.resize(size);
+        return data;
+    }
+
+    // 1, 2, 4, ... até o número de núcleos (inclusive)
+    inline std::vector<size_t> ThreadCounts()
+    {
+        size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+        std::vector<size_t> counts;
+        for (size_t n = 1; n < cores; n *= 2)
+        {
+            counts.push_back(n);
+        }
+        counts.push_back(cores);
+        return counts;
+    }
+
+    inline void Report(const char *label, double seconds, uint64_t bytes, uint64_t items)
+    {
+        seconds = std::max(seconds, 1e-9);
+        std::printf("%-38s %9.3f s %10.1f MB/s %12.0f itens/s\n", label, seconds,
+                    bytes / seconds / (1024.0 * 1024.0), items / seconds);
+    }
+
+} // namespace autopatch::bench
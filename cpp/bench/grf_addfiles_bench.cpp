@@ -0,0 +1,69 @@
+// AddFiles: compressão em paralelo no pool com gravação em ordem, contra AddFile
+// entrada a entrada. Mede um lote sintético de arquivos pequenos com 1, 2, 4... threads.
+//
+// Uso: grf_addfiles_bench [arquivos=50000]
+
+#include "bench_common.h"
+#include "../src/core/grf.h"
+#include "../src/core/thread_pool.h"
+
+using namespace autopatch;
+using namespace autopatch::bench;
+
+int main(int argc, char **argv)
+{
+    size_t count = ArgOr(argc, argv, 1, 50000);
+
+    // 256 B a 8 KB, comprimíveis como os textos e tabelas de um patch
+    std::vector<GrfAddItem> batch(count);
+    uint64_t totalBytes = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        batch[i].filename = "data\\bench\\" + std::to_string(i % 128) + "\\file_" + std::to_string(i) + ".txt";
+        batch[i].data = TextBytes(256 + (i * 7919) % (8 * 1024), i);
+        totalBytes += batch[i].data.size();
+    }
+    std::printf("%zu arquivos, %.1f MB descomprimidos\n", count, totalBytes / (1024.0 * 1024.0));
+
+    std::filesystem::path dir = TempDir("grf_addfiles_bench");
+    std::filesystem::path path = dir / "bench.grf";
+
+    double serialSeconds = 0;
+    {
+        GrfFile grf;
+        grf.Create(path.wstring());
+        Timer timer;
+        for (const GrfAddItem &item : batch)
+        {
+            grf.AddFile(item.filename, item.data);
+        }
+        grf.Save();
+        serialSeconds = timer.Seconds();
+        Report("AddFile (serial)", serialSeconds, totalBytes, count);
+    }
+
+    for (size_t threads : ThreadCounts())
+    {
+        std::vector<GrfAddItem> items = batch;
+        ThreadPool pool(threads);
+
+        GrfFile grf;
+        grf.Create(path.wstring());
+        Timer timer;
+        size_t stored = grf.AddFiles(std::move(items), &pool);
+        grf.Save();
+        double seconds = timer.Seconds();
+
+        if (stored != count)
+        {
+            std::fprintf(stderr, "AddFiles gravou %zu de %zu\n", stored, count);
+            return 1;
+        }
+        std::string label = "AddFiles (" + std::to_string(threads) + " threads)";
+        Report(label.c_str(), seconds, totalBytes, count);
+        std::printf("%38s %9.2fx sobre o serial\n", "", serialSeconds / seconds);
+    }
+
+    RemoveDir(dir);
+    return 0;
+}
@@ -0,0 +1,75 @@
+// DES do GRF: vazão do bloco isolado e da decodificação de entradas inteiras
+// (MIXCRYPT com o cycle real de cada tamanho, e DES só nos blocos do cabeçalho).
+//
+// Uso: grf_des_bench [MB=256] [rodadas=3]
+
+#include "bench_common.h"
+#include "../src/core/grf.h"
+#include "../src/core/grf_des.h"
+
+using namespace autopatch;
+using namespace autopatch::bench;
+
+namespace
+{
+
+    template <typename Run>
+    double BestOf(size_t rounds, Run run)
+    {
+        double best = 1e30;
+        for (size_t r = 0; r < rounds; r++)
+        {
+            Timer timer;
+            run();
+            best = std::min(best, timer.Seconds());
+        }
+        return best;
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t megabytes = ArgOr(argc, argv, 1, 256);
+    size_t rounds = ArgOr(argc, argv, 2, 3);
+
+    std::vector<uint8_t> data = RandomBytes(megabytes * 1024 * 1024, 1);
+    std::printf("%.1f MB de dados\n", data.size() / (1024.0 * 1024.0));
+
+    // Todos os blocos (equivale a uma entrada com cycle 1)
+    double seconds = BestOf(rounds, [&]()
+                            {
+                                for (size_t pos = 0; pos + 8 <= data.size(); pos += 8)
+                                {
+                                    GrfDesDecryptBlock(data.data() + pos);
+                                } });
+    Report("GrfDesDecryptBlock", seconds, data.size(), data.size() / 8);
+
+    // Entradas de tamanhos variados (1 KB a 256 KB, alinhados a 8) como num GRF 0x103
+    std::vector<std::pair<size_t, size_t>> entries; // offset, tamanho
+    for (size_t pos = 0, i = 0; pos < data.size(); i++)
+    {
+        size_t size = std::min<size_t>(1024 + (i * 7919 * 8) % (256 * 1024), data.size() - pos) & ~size_t(7);
+        if (size == 0)
+        {
+            break;
+        }
+        entries.emplace_back(pos, size);
+        pos += size;
+    }
+
+    for (uint8_t flags : {uint8_t(GRFFILE_FLAG_FILE | GRFFILE_FLAG_MIXCRYPT), uint8_t(GRFFILE_FLAG_FILE | GRFFILE_FLAG_DES)})
+    {
+        seconds = BestOf(rounds, [&]()
+                         {
+                             for (auto [offset, size] : entries)
+                             {
+                                 uint32_t cycle = GrfDesCycle(static_cast<uint32_t>(size));
+                                 GrfDecodeEntry(data.data() + offset, size, flags, cycle);
+                             } });
+        Report(flags & GRFFILE_FLAG_MIXCRYPT ? "GrfDecodeEntry (MIXCRYPT)" : "GrfDecodeEntry (DES)",
+               seconds, data.size(), entries.size());
+    }
+
+    return 0;
+}
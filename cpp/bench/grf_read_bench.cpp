@@ -0,0 +1,97 @@
+// Leitura de entradas do GRF: stream (ReadAt + vetor novo por entrada) contra o modo
+// mapeado (ExtractView com buffer reaproveitado, sem cópia do dado comprimido).
+//
+// Uso: grf_read_bench [entradas=20000] [rodadas=3]
+
+#include "bench_common.h"
+#include "../src/core/grf.h"
+
+using namespace autopatch;
+using namespace autopatch::bench;
+
+namespace
+{
+
+    bool BuildGrf(const std::filesystem::path &path, size_t count, std::vector<std::string> &names, uint64_t &totalBytes)
+    {
+        std::vector<GrfAddItem> items(count);
+        totalBytes = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            items[i].filename = "data\\bench\\" + std::to_string(i % 64) + "\\file_" + std::to_string(i) + ".txt";
+            items[i].data = TextBytes(1024 + (i * 7919) % (64 * 1024), i);
+            totalBytes += items[i].data.size();
+            names.push_back(items[i].filename);
+        }
+
+        GrfFile grf;
+        return grf.Create(path.wstring()) && grf.AddFiles(std::move(items)) == count && grf.Save();
+    }
+
+    // Melhor de 'rounds' passadas sobre todas as entradas (a primeira aquece o cache do SO)
+    template <typename Read>
+    double BestOf(size_t rounds, const std::vector<std::string> &names, Read read)
+    {
+        double best = 1e30;
+        for (size_t r = 0; r < rounds; r++)
+        {
+            Timer timer;
+            for (const std::string &name : names)
+            {
+                if (!read(name))
+                {
+                    std::fprintf(stderr, "falha ao ler %s\n", name.c_str());
+                    std::exit(1);
+                }
+            }
+            best = std::min(best, timer.Seconds());
+        }
+        return best;
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t count = ArgOr(argc, argv, 1, 20000);
+    size_t rounds = ArgOr(argc, argv, 2, 3);
+
+    std::filesystem::path dir = TempDir("grf_read_bench");
+    std::filesystem::path path = dir / "bench.grf";
+    std::vector<std::string> names;
+    uint64_t totalBytes = 0;
+    if (!BuildGrf(path, count, names, totalBytes))
+    {
+        std::fprintf(stderr, "falha ao gerar o GRF\n");
+        return 1;
+    }
+    std::printf("%zu entradas, %.1f MB descomprimidos\n", count, totalBytes / (1024.0 * 1024.0));
+
+    {
+        GrfFile grf;
+        grf.Open(path.wstring());
+        double seconds = BestOf(rounds, names, [&](const std::string &name)
+                                { return !grf.ExtractFile(name).empty(); });
+        Report("stream ExtractFile", seconds, totalBytes, count);
+
+        std::vector<uint8_t> buffer;
+        seconds = BestOf(rounds, names, [&](const std::string &name)
+                         { return grf.ExtractInto(name, buffer); });
+        Report("stream ExtractInto (buffer reusado)", seconds, totalBytes, count);
+    }
+    {
+        GrfFile grf;
+        grf.Open(path.wstring(), GrfOpenMode::ReadOnlyMapped);
+        double seconds = BestOf(rounds, names, [&](const std::string &name)
+                                { return !grf.ExtractFile(name).empty(); });
+        Report("mapeado ExtractFile", seconds, totalBytes, count);
+
+        std::vector<uint8_t> buffer;
+        seconds = BestOf(rounds, names, [&](const std::string &name)
+                         { return !grf.ExtractView(name, buffer).empty(); });
+        Report("mapeado ExtractView", seconds, totalBytes, count);
+    }
+
+    RemoveDir(dir);
+    return 0;
+}
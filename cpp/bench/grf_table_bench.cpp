@@ -0,0 +1,128 @@
+// Parse da tabela de arquivos: ParseGrfFileTable (terminadores com SSE2, laço
+// especializado por versão, inserção em lote) contra o laço escalar anterior
+// (strlen por nome, Find + Insert e tamanho do offset decidido a cada entrada).
+//
+// Uso: grf_table_bench [entradas=4000000] [rodadas=3]
+
+#include "bench_common.h"
+#include "../src/core/grf_table.h"
+
+using namespace autopatch;
+using namespace autopatch::bench;
+
+namespace
+{
+
+    // Tabela descomprimida com nomes de 20 a 70 bytes, como a de um data.grf
+    std::vector<uint8_t> BuildTable(size_t count, size_t offsetSize)
+    {
+        static const char *const DIRS[] = {"data\\texture\\유저인터페이스\\", "data\\sprite\\몬스터\\",
+                                           "data\\model\\prontera\\", "data\\wav\\", "data\\"};
+        std::vector<uint8_t> table;
+        table.reserve(count * 64);
+        uint64_t offset = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            std::string name = DIRS[i % 5] + std::string(i % 7, 'x') + "file_" + std::to_string(i) + ".bmp";
+            table.insert(table.end(), name.begin(), name.end());
+            table.push_back(0);
+
+            uint32_t size = static_cast<uint32_t>(100 + i % 5000);
+            uint32_t fields[3] = {size, (size + 7) & ~7u, size * 3};
+            const uint8_t *raw = reinterpret_cast<const uint8_t *>(fields);
+            table.insert(table.end(), raw, raw + sizeof(fields));
+            table.push_back(1);
+            for (size_t b = 0; b < offsetSize; b++)
+            {
+                table.push_back(static_cast<uint8_t>(offset >> (8 * b)));
+            }
+            offset += fields[1];
+        }
+        return table;
+    }
+
+    // Laço de ReadFileTable antes do parser em lote
+    bool ParseScalar(const std::vector<uint8_t> &tableData, uint32_t count, bool largeOffsets,
+                     GrfNameIndex &index, GrfFileTable &table)
+    {
+        index.Reserve(count);
+        table.Reserve(count);
+
+        size_t pos = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            size_t offsetSize = largeOffsets ? 8 : 4;
+
+            std::string_view filename = reinterpret_cast<const char *>(&tableData[pos]);
+            pos += filename.length() + 1;
+
+            uint32_t row = index.Find(filename);
+            if (row == GrfNameIndex::npos)
+            {
+                row = index.Insert(filename);
+                if (row == GrfNameIndex::npos)
+                {
+                    return false;
+                }
+                table.Append();
+            }
+
+            memcpy(&table.compressedSize[row], &tableData[pos], 4);
+            pos += 4;
+            memcpy(&table.compressedSizeAligned[row], &tableData[pos], 4);
+            pos += 4;
+            memcpy(&table.uncompressedSize[row], &tableData[pos], 4);
+            pos += 4;
+            table.flags[row] = tableData[pos++];
+            table.offset[row] = 0;
+            memcpy(&table.offset[row], &tableData[pos], offsetSize);
+            pos += offsetSize;
+        }
+        return true;
+    }
+
+    template <typename Parse>
+    double BestOf(size_t rounds, size_t count, Parse parse)
+    {
+        double best = 1e30;
+        for (size_t r = 0; r < rounds; r++)
+        {
+            GrfNameIndex index;
+            GrfFileTable table;
+            Timer timer;
+            bool ok = parse(index, table);
+            double seconds = timer.Seconds();
+            if (!ok || table.Size() != count)
+            {
+                std::fprintf(stderr, "parse falhou\n");
+                std::exit(1);
+            }
+            best = std::min(best, seconds);
+        }
+        return best;
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint32_t count = static_cast<uint32_t>(ArgOr(argc, argv, 1, 4000000));
+    size_t rounds = ArgOr(argc, argv, 2, 3);
+
+    for (bool largeOffsets : {false, true})
+    {
+        std::vector<uint8_t> data = BuildTable(count, largeOffsets ? 8 : 4);
+        std::printf("%s: %u entradas, tabela de %.1f MB\n", largeOffsets ? "0x300" : "0x200", count,
+                    data.size() / (1024.0 * 1024.0));
+
+        double scalar = BestOf(rounds, count, [&](GrfNameIndex &index, GrfFileTable &table)
+                               { return ParseScalar(data, count, largeOffsets, index, table); });
+        Report("escalar (anterior)", scalar, data.size(), count);
+
+        double batched = BestOf(rounds, count, [&](GrfNameIndex &index, GrfFileTable &table)
+                                { return ParseGrfFileTable(data.data(), data.size(), count, largeOffsets, index, table); });
+        Report("ParseGrfFileTable", batched, data.size(), count);
+        std::printf("%38s %9.2fx sobre o escalar\n", "", scalar / batched);
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+// ThorFile::ApplyToDisk: extração paralela com cache de diretórios, contra o laço
+// serial (ExtractInto + create_directories + ofstream por entrada), num THOR de
+// extração para disco com muitos arquivos pequenos.
+//
+// Uso: thor_apply_bench [arquivos=30000]
+
+#include "bench_common.h"
+#include "../src/core/grf_table.h"
+#include "../src/core/thor.h"
+#include "../src/core/thor_writer.h"
+#include "../src/core/thread_pool.h"
+
+#include <fstream>
+
+using namespace autopatch;
+using namespace autopatch::bench;
+
+namespace
+{
+
+    bool ApplySerial(ThorFile &thor, const std::filesystem::path &outputDir)
+    {
+        std::vector<uint8_t> buffer;
+        for (const ThorEntry &entry : thor.GetEntries())
+        {
+            // O THOR do benchmark só tem adições (flag 0x01 = remoção)
+            std::filesystem::path relative;
+            if ((entry.flags & 0x01) != 0 || !GrfNameToPath(entry.filename, relative) || !thor.ExtractInto(entry, buffer))
+            {
+                return false;
+            }
+            std::filesystem::path target = outputDir / relative;
+            std::error_code ec;
+            std::filesystem::create_directories(target.parent_path(), ec);
+            std::ofstream out(target, std::ios::binary);
+            out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+            if (!out.good())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t count = ArgOr(argc, argv, 1, 30000);
+
+    std::filesystem::path dir = TempDir("thor_apply_bench");
+    std::filesystem::path thorPath = dir / "bench.thor";
+    std::filesystem::path outputDir = dir / "out";
+
+    // 64 B a 6 KB por arquivo, espalhados por 300 diretórios
+    uint64_t totalBytes = 0;
+    {
+        ThorWriter writer;
+        writer.SetUseGrfMerging(false);
+        for (size_t i = 0; i < count; i++)
+        {
+            std::vector<uint8_t> data = TextBytes(64 + (i * 7919) % 6144, i);
+            totalBytes += data.size();
+            writer.AddFile("data\\bench\\" + std::to_string(i % 300) + "\\file_" + std::to_string(i) + ".txt", std::move(data));
+        }
+        if (!writer.Write(thorPath.wstring()))
+        {
+            std::fprintf(stderr, "falha ao gerar o THOR\n");
+            return 1;
+        }
+    }
+    std::printf("%zu arquivos, %.1f MB descomprimidos\n", count, totalBytes / (1024.0 * 1024.0));
+
+    ThorFile thor;
+    if (!thor.Open(thorPath.wstring()) || thor.GetEntries().size() != count)
+    {
+        std::fprintf(stderr, "falha ao abrir o THOR\n");
+        return 1;
+    }
+
+    RemoveDir(outputDir);
+    Timer serialTimer;
+    if (!ApplySerial(thor, outputDir))
+    {
+        std::fprintf(stderr, "falha na extração serial\n");
+        return 1;
+    }
+    double serialSeconds = serialTimer.Seconds();
+    Report("serial (ExtractInto + ofstream)", serialSeconds, totalBytes, count);
+
+    for (size_t threads : ThreadCounts())
+    {
+        RemoveDir(outputDir);
+        ThreadPool pool(threads);
+        Timer timer;
+        bool ok = thor.ApplyToDisk(outputDir.wstring(), &pool);
+        double seconds = timer.Seconds();
+        if (!ok)
+        {
+            std::fprintf(stderr, "ApplyToDisk falhou\n");
+            return 1;
+        }
+        std::string label = "ApplyToDisk (" + std::to_string(threads) + " threads)";
+        Report(label.c_str(), seconds, totalBytes, count);
+        std::printf("%38s %9.2fx sobre o serial\n", "", serialSeconds / seconds);
+    }
+
+    thor.Close();
+    RemoveDir(dir);
+    return 0;
+}
@@ -0,0 +1,98 @@
+// ThorWriter: geração de um patch a partir de um diretório de atualização do cliente
+// (mistura de texto/tabelas comprimíveis, texturas e sons pouco comprimíveis e alguns
+// arquivos maiores que a janela), com 1, 2, 4... threads de compressão.
+//
+// Uso: thor_writer_bench [MB=5120]
+
+#include "bench_common.h"
+#include "../src/core/thor_writer.h"
+#include "../src/core/thread_pool.h"
+
+#include <fstream>
+
+using namespace autopatch;
+using namespace autopatch::bench;
+
+namespace
+{
+
+    bool WriteSource(const std::filesystem::path &path, const std::vector<uint8_t> &data)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        return out.good();
+    }
+
+    // Gera arquivos até 'totalBytes': a cada 1000 arquivos um de 80 MB (stream), o resto
+    // entre 4 KB e 2 MB, metade comprimível e metade aleatória
+    bool BuildSource(const std::filesystem::path &dir, uint64_t totalBytes, size_t &fileCount)
+    {
+        uint64_t written = 0;
+        fileCount = 0;
+        for (size_t i = 0; written < totalBytes; i++)
+        {
+            size_t size = i % 1000 == 999 ? 80 * 1024 * 1024 : 4096 + (i * 7919 * 13) % (2 * 1024 * 1024);
+            size = static_cast<size_t>(std::min<uint64_t>(size, totalBytes - written));
+            std::vector<uint8_t> data = i % 2 ? RandomBytes(size, i) : TextBytes(size, i);
+
+            std::filesystem::path path = dir / std::to_string(i % 200) / ("file_" + std::to_string(i) + (i % 2 ? ".bmp" : ".txt"));
+            if (!WriteSource(path, data))
+            {
+                return false;
+            }
+            written += size;
+            fileCount++;
+        }
+        return true;
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint64_t megabytes = ArgOr(argc, argv, 1, 5120);
+    uint64_t totalBytes = megabytes * 1024 * 1024;
+
+    std::filesystem::path dir = TempDir("thor_writer_bench");
+    std::filesystem::path source = dir / "source";
+    size_t fileCount = 0;
+    if (!BuildSource(source, totalBytes, fileCount))
+    {
+        std::fprintf(stderr, "falha ao gerar os arquivos de origem\n");
+        return 1;
+    }
+    std::printf("%zu arquivos, %.1f MB\n", fileCount, totalBytes / (1024.0 * 1024.0));
+
+    double baseline = 0;
+    for (size_t threads : ThreadCounts())
+    {
+        ThreadPool pool(threads);
+        std::filesystem::path thorPath = dir / "bench.thor";
+
+        Timer timer;
+        ThorWriter writer;
+        size_t added = writer.AddDirectory(source.wstring(), "data\\");
+        bool ok = added == fileCount && writer.Write(thorPath.wstring(), ThorMode::MultiFile, &pool);
+        double seconds = timer.Seconds();
+        if (!ok)
+        {
+            std::fprintf(stderr, "falha ao gravar o THOR\n");
+            return 1;
+        }
+
+        std::error_code ec;
+        uint64_t thorSize = std::filesystem::file_size(thorPath, ec);
+        std::string label = "ThorWriter (" + std::to_string(threads) + " threads)";
+        Report(label.c_str(), seconds, totalBytes, fileCount);
+        if (threads == 1)
+        {
+            baseline = seconds;
+        }
+        std::printf("%38s %9.2fx sobre 1 thread, THOR de %.1f MB\n", "", baseline / seconds, thorSize / (1024.0 * 1024.0));
+    }
+
+    RemoveDir(dir);
+    return 0;
+}
@@ -0,0 +1,350 @@
+#include "codec.h"
+#include <zlib.h>
+
+namespace autopatch
+{
+
+    size_t BufferPool::ClassOf(size_t size)
+    {
+        size_t bits = MIN_CLASS_BITS;
+        while (bits <= MAX_CLASS_BITS && (static_cast<size_t>(1) << bits) < size)
+        {
+            bits++;
+        }
+        return bits;
+    }
+
+    std::vector<uint8_t> BufferPool::Acquire(size_t size)
+    {
+        size_t bits = ClassOf(size);
+        if (bits > MAX_CLASS_BITS)
+        {
+            return std::vector<uint8_t>(size);
+        }
+
+        auto &pool = m_classes[bits - MIN_CLASS_BITS];
+        std::vector<uint8_t> buffer;
+        if (!pool.empty())
+        {
+            buffer = std::move(pool.back());
+            pool.pop_back();
+            m_pooledBytes -= buffer.capacity();
+        }
+        else
+        {
+            buffer.reserve(static_cast<size_t>(1) << bits);
+        }
+
+        buffer.resize(size);
+        return buffer;
+    }
+
+    void BufferPool::Release(std::vector<uint8_t> &&buffer)
+    {
+        // Classe = maior potência de 2 que cabe na capacidade (atende pedidos até esse tamanho)
+        size_t capacity = buffer.capacity();
+        if (capacity < (static_cast<size_t>(1) << MIN_CLASS_BITS))
+        {
+            return;
+        }
+
+        size_t bits = MIN_CLASS_BITS;
+        while (bits < MAX_CLASS_BITS && (static_cast<size_t>(1) << (bits + 1)) <= capacity)
+        {
+            bits++;
+        }
+        if ((static_cast<size_t>(1) << (bits + 1)) <= capacity)
+        {
+            return; // Maior que a maior classe
+        }
+
+        auto &pool = m_classes[bits - MIN_CLASS_BITS];
+        if (pool.size() < BUFFERS_PER_CLASS && m_pooledBytes + capacity <= MAX_POOLED_BYTES)
+        {
+            m_pooledBytes += capacity;
+            pool.push_back(std::move(buffer));
+        }
+        buffer = {};
+    }
+
+    CodecContext::CodecContext()
+        : m_inflate(std::make_unique<z_stream>()),
+          m_rawInflate(std::make_unique<z_stream>()),
+          m_deflate(std::make_unique<z_stream>())
+    {
+    }
+
+    CodecContext::~CodecContext()
+    {
+        if (m_inflateReady)
+        {
+            inflateEnd(m_inflate.get());
+        }
+        if (m_rawInflateReady)
+        {
+            inflateEnd(m_rawInflate.get());
+        }
+        if (m_deflateReady)
+        {
+            deflateEnd(m_deflate.get());
+        }
+    }
+
+    z_stream_s *CodecContext::ResetInflate(bool raw)
+    {
+        z_stream *strm = raw ? m_rawInflate.get() : m_inflate.get();
+        bool &ready = raw ? m_rawInflateReady : m_inflateReady;
+
+        // Inicializa uma vez; nas próximas chamadas só reseta o estado
+        if (!ready)
+        {
+            *strm = {};
+            if (inflateInit2(strm, raw ? -MAX_WBITS : MAX_WBITS) != Z_OK)
+            {
+                return nullptr;
+            }
+            ready = true;
+        }
+        else if (inflateReset(strm) != Z_OK)
+        {
+            return nullptr;
+        }
+        return strm;
+    }
+
+    bool CodecContext::Inflate(const uint8_t *data, size_t size, size_t uncompressedSize, std::vector<uint8_t> &out, bool raw)
+    {
+        z_stream *strm = ResetInflate(raw);
+        if (!strm)
+        {
+            return false;
+        }
+
+        out.resize(uncompressedSize);
+
+        // zlib recusa next_out nulo, mesmo com saída vazia
+        uint8_t empty = 0;
+        strm->next_in = const_cast<Bytef *>(data);
+        strm->avail_in = static_cast<uInt>(size);
+        strm->next_out = out.empty() ? &empty : out.data();
+        strm->avail_out = static_cast<uInt>(out.size());
+
+        int ret = inflate(strm, Z_FINISH);
+        if (ret != Z_STREAM_END)
+        {
+            out.clear();
+            return false;
+        }
+
+        out.resize(strm->total_out);
+        return true;
+    }
+
+    z_stream_s *CodecContext::ResetDeflate()
+    {
+        z_stream *strm = m_deflate.get();
+        if (!m_deflateReady)
+        {
+            *strm = {};
+            if (deflateInit(strm, Z_DEFAULT_COMPRESSION) != Z_OK)
+            {
+                return nullptr;
+            }
+            m_deflateReady = true;
+        }
+        else if (deflateReset(strm) != Z_OK)
+        {
+            return nullptr;
+        }
+        return strm;
+    }
+
+    bool CodecContext::Deflate(const uint8_t *data, size_t size, std::vector<uint8_t> &out)
+    {
+        z_stream *strm = ResetDeflate();
+        if (!strm)
+        {
+            return false;
+        }
+
+        out.resize(deflateBound(strm, static_cast<uLong>(size)));
+
+        strm->next_in = const_cast<Bytef *>(data);
+        strm->avail_in = static_cast<uInt>(size);
+        strm->next_out = out.data();
+        strm->avail_out = static_cast<uInt>(out.size());
+
+        if (deflate(strm, Z_FINISH) != Z_STREAM_END)
+        {
+            out.clear();
+            return false;
+        }
+
+        out.resize(strm->total_out);
+        return true;
+    }
+
+    bool CodecContext::DeflateStream(const StreamReader &read, const StreamWriter &write, uint64_t &totalIn, uint64_t &totalOut)
+    {
+        totalIn = 0;
+        totalOut = 0;
+
+        z_stream *strm = ResetDeflate();
+        if (!strm)
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> in = m_buffers.Acquire(STREAM_CHUNK_SIZE);
+        std::vector<uint8_t> out = m_buffers.Acquire(STREAM_CHUNK_SIZE);
+
+        bool ok = true;
+        int flush = Z_NO_FLUSH;
+        while (ok && flush != Z_FINISH)
+        {
+            size_t count = 0;
+            if (!read(in.data(), STREAM_CHUNK_SIZE, count) || count > STREAM_CHUNK_SIZE)
+            {
+                ok = false;
+                break;
+            }
+            totalIn += count;
+            flush = count == 0 ? Z_FINISH : Z_NO_FLUSH;
+
+            strm->next_in = in.data();
+            strm->avail_in = static_cast<uInt>(count);
+
+            // Esvazia a saída até o deflate consumir o bloco (ou terminar, no Z_FINISH)
+            do
+            {
+                strm->next_out = out.data();
+                strm->avail_out = static_cast<uInt>(STREAM_CHUNK_SIZE);
+                if (deflate(strm, flush) == Z_STREAM_ERROR)
+                {
+                    ok = false;
+                    break;
+                }
+
+                size_t produced = STREAM_CHUNK_SIZE - strm->avail_out;
+                if (produced > 0 && !write(out.data(), produced))
+                {
+                    ok = false;
+                    break;
+                }
+                totalOut += produced;
+            } while (strm->avail_out == 0);
+        }
+
+        m_buffers.Release(std::move(in));
+        m_buffers.Release(std::move(out));
+        return ok;
+    }
+
+    bool CodecContext::InflateStream(const StreamReader &read, const StreamWriter &write, bool raw, uint64_t &totalIn, uint64_t &totalOut)
+    {
+        totalIn = 0;
+        totalOut = 0;
+
+        z_stream *strm = ResetInflate(raw);
+        if (!strm)
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> in = m_buffers.Acquire(STREAM_CHUNK_SIZE);
+        std::vector<uint8_t> out = m_buffers.Acquire(STREAM_CHUNK_SIZE);
+
+        bool ok = true;
+        int ret = Z_OK;
+        while (ok && ret != Z_STREAM_END)
+        {
+            // Entrada acabou antes do fim do stream: dados truncados
+            size_t count = 0;
+            if (!read(in.data(), STREAM_CHUNK_SIZE, count) || count == 0 || count > STREAM_CHUNK_SIZE)
+            {
+                ok = false;
+                break;
+            }
+
+            strm->next_in = in.data();
+            strm->avail_in = static_cast<uInt>(count);
+
+            // Esvazia a saída até o bloco ser consumido (Z_BUF_ERROR = precisa de mais entrada)
+            do
+            {
+                strm->next_out = out.data();
+                strm->avail_out = static_cast<uInt>(STREAM_CHUNK_SIZE);
+                ret = inflate(strm, Z_NO_FLUSH);
+                if (ret == Z_BUF_ERROR)
+                {
+                    break;
+                }
+                if (ret != Z_OK && ret != Z_STREAM_END)
+                {
+                    ok = false;
+                    break;
+                }
+
+                size_t produced = STREAM_CHUNK_SIZE - strm->avail_out;
+                if (produced > 0 && !write(out.data(), produced))
+                {
+                    ok = false;
+                    break;
+                }
+                totalOut += produced;
+            } while (ret != Z_STREAM_END && strm->avail_out == 0);
+        }
+
+        totalIn = strm->total_in;
+        m_buffers.Release(std::move(in));
+        m_buffers.Release(std::move(out));
+        return ok;
+    }
+
+    bool CodecContext::InflateChecksum(const uint8_t *data, size_t size, uint32_t &adler, uint64_t &uncompressedSize)
+    {
+        z_stream *strm = ResetInflate(true);
+        if (!strm)
+        {
+            return false;
+        }
+
+        constexpr size_t CHUNK_SIZE = 64 * 1024;
+        std::vector<uint8_t> chunk = m_buffers.Acquire(CHUNK_SIZE);
+
+        uLong checksum = adler32(0L, Z_NULL, 0);
+        strm->next_in = const_cast<Bytef *>(data);
+        strm->avail_in = static_cast<uInt>(size);
+
+        int ret;
+        do
+        {
+            strm->next_out = chunk.data();
+            strm->avail_out = static_cast<uInt>(CHUNK_SIZE);
+            ret = inflate(strm, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END)
+            {
+                break;
+            }
+            checksum = adler32(checksum, chunk.data(), static_cast<uInt>(CHUNK_SIZE - strm->avail_out));
+        } while (ret != Z_STREAM_END && strm->avail_out == 0);
+
+        m_buffers.Release(std::move(chunk));
+
+        if (ret != Z_STREAM_END)
+        {
+            return false;
+        }
+
+        adler = static_cast<uint32_t>(checksum);
+        uncompressedSize = strm->total_out;
+        return true;
+    }
+
+    CodecContext &CodecContext::ForThread()
+    {
+        thread_local CodecContext context;
+        return context;
+    }
+
+} // namespace autopatch
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+struct z_stream_s;
+
+namespace autopatch
+{
+
+    // Pool de buffers por classe de tamanho (potências de 2, de 4 KB a 4 MB).
+    // Cada thread tem o seu (CodecContext::ForThread) e o guarda enquanto a thread viver,
+    // então a retenção é limitada: buffers maiores que a maior classe não são guardados
+    // e o total guardado não passa de MAX_POOLED_BYTES.
+    class BufferPool
+    {
+    public:
+        static constexpr size_t MAX_POOLED_BYTES = 8 * 1024 * 1024;
+
+        // Vetor com size() == size; o conteúdo é indefinido
+        std::vector<uint8_t> Acquire(size_t size);
+
+        // Devolve um buffer para reuso (descartado se não couber no limite)
+        void Release(std::vector<uint8_t> &&buffer);
+
+        // Bytes guardados no pool
+        size_t PooledBytes() const { return m_pooledBytes; }
+
+    private:
+        static constexpr size_t MIN_CLASS_BITS = 12;
+        static constexpr size_t MAX_CLASS_BITS = 22;
+        static constexpr size_t BUFFERS_PER_CLASS = 4;
+
+        static size_t ClassOf(size_t size);
+
+        std::vector<std::vector<uint8_t>> m_classes[MAX_CLASS_BITS - MIN_CLASS_BITS + 1];
+        size_t m_pooledBytes = 0;
+    };
+
+    // Estado zlib reaproveitável entre chamadas (inflateReset/deflateReset em vez de
+    // Init/End por entrada) mais um pool de buffers. Não é thread-safe: use ForThread().
+    class CodecContext
+    {
+    public:
+        CodecContext();
+        ~CodecContext();
+
+        CodecContext(const CodecContext &) = delete;
+        CodecContext &operator=(const CodecContext &) = delete;
+
+        // Descomprime um stream zlib (raw = deflate puro, sem header) para exatamente
+        // 'uncompressedSize' bytes em 'out'. A capacidade de 'out' é reaproveitada.
+        bool Inflate(const uint8_t *data, size_t size, size_t uncompressedSize, std::vector<uint8_t> &out, bool raw = false);
+
+        // Comprime em um stream zlib (mesma saída de compress())
+        bool Deflate(const uint8_t *data, size_t size, std::vector<uint8_t> &out);
+
+        // Compressão em stream (mesma saída de Deflate): 'read' preenche até 'capacity' bytes
+        // e informa quantos leu (0 = fim dos dados); 'write' recebe cada bloco comprimido.
+        // Usa dois buffers de STREAM_CHUNK_SIZE do pool, seja qual for o tamanho dos dados.
+        static constexpr size_t STREAM_CHUNK_SIZE = 1024 * 1024;
+        using StreamReader = std::function<bool(uint8_t *dst, size_t capacity, size_t &read)>;
+        using StreamWriter = std::function<bool(const uint8_t *data, size_t size)>;
+        bool DeflateStream(const StreamReader &read, const StreamWriter &write, uint64_t &totalIn, uint64_t &totalOut);
+
+        // Descompressão em stream, com os mesmos buffers de STREAM_CHUNK_SIZE: 'read' entrega
+        // o stream comprimido em blocos (0 antes do fim do stream = erro) e 'write' recebe
+        // cada bloco descomprimido. totalIn = bytes comprimidos consumidos até o fim do stream.
+        bool InflateStream(const StreamReader &read, const StreamWriter &write, bool raw, uint64_t &totalIn, uint64_t &totalOut);
+
+        // Percorre um stream deflate puro sem guardar a saída; retorna o Adler-32 dos dados
+        // descomprimidos e o tamanho descomprimido
+        bool InflateChecksum(const uint8_t *data, size_t size, uint32_t &adler, uint64_t &uncompressedSize);
+
+        BufferPool &Buffers() { return m_buffers; }
+
+        // Contexto da thread atual (criado no primeiro uso)
+        static CodecContext &ForThread();
+
+    private:
+        z_stream_s *ResetInflate(bool raw);
+        z_stream_s *ResetDeflate();
+
+        std::unique_ptr<z_stream_s> m_inflate;
+        std::unique_ptr<z_stream_s> m_rawInflate;
+        std::unique_ptr<z_stream_s> m_deflate;
+        bool m_inflateReady = false;
+        bool m_rawInflateReady = false;
+        bool m_deflateReady = false;
+        BufferPool m_buffers;
+    };
+
+} // namespace autopatch
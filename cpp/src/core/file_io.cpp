@@ -0,0 +1,518 @@
+#include "file_io.h"
+
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <filesystem>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#endif
+
+namespace autopatch
+{
+
+    MappedFile::MappedFile() = default;
+
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+#ifdef _WIN32
+
+    bool MappedFile::Open(const std::wstring &path)
+    {
+        Close();
+
+        HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                   nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(hFile, &size))
+        {
+            CloseHandle(hFile);
+            return false;
+        }
+
+        m_hFile = hFile;
+        m_size = static_cast<uint64_t>(size.QuadPart);
+
+        // Arquivo vazio não pode ser mapeado, mas é válido
+        if (m_size == 0)
+        {
+            m_isOpen = true;
+            return true;
+        }
+
+        HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!hMapping)
+        {
+            Close();
+            return false;
+        }
+        m_hMapping = hMapping;
+
+        m_data = static_cast<const uint8_t *>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+        if (!m_data)
+        {
+            // Sem espaço de endereçamento (ex: processo 32 bits com GRF de vários GB)
+            Close();
+            return false;
+        }
+
+        m_isOpen = true;
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_hMapping)
+        {
+            CloseHandle(m_hMapping);
+        }
+        if (m_hFile)
+        {
+            CloseHandle(m_hFile);
+        }
+
+        m_data = nullptr;
+        m_hMapping = nullptr;
+        m_hFile = nullptr;
+        m_size = 0;
+        m_isOpen = false;
+    }
+
+#else
+
+    bool MappedFile::Open(const std::wstring &path)
+    {
+        Close();
+
+        int fd = ::open(std::filesystem::path(path).c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        m_fd = fd;
+        m_size = static_cast<uint64_t>(st.st_size);
+
+        if (m_size == 0)
+        {
+            m_isOpen = true;
+            return true;
+        }
+
+        void *data = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            Close();
+            return false;
+        }
+
+        m_data = static_cast<const uint8_t *>(data);
+        m_isOpen = true;
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_data)
+        {
+            munmap(const_cast<uint8_t *>(m_data), static_cast<size_t>(m_size));
+        }
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+        }
+
+        m_data = nullptr;
+        m_fd = -1;
+        m_size = 0;
+        m_isOpen = false;
+    }
+
+#endif
+
+    File::File() = default;
+
+    File::~File()
+    {
+        Close();
+    }
+
+#ifdef _WIN32
+
+    // Evento por thread para esperar operações overlapped (cada thread espera só as suas)
+    static HANDLE ThreadIoEvent()
+    {
+        struct IoEvent
+        {
+            HANDLE handle = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            ~IoEvent()
+            {
+                if (handle)
+                {
+                    CloseHandle(handle);
+                }
+            }
+        };
+
+        thread_local IoEvent event;
+        return event.handle;
+    }
+
+    // Executa uma leitura/escrita overlapped e espera a conclusão
+    template <typename IoFunction>
+    static DWORD OverlappedIo(HANDLE hFile, uint64_t offset, IoFunction io)
+    {
+        OVERLAPPED ov = {};
+        ov.Offset = static_cast<DWORD>(offset);
+        ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        ov.hEvent = ThreadIoEvent();
+
+        DWORD transferred = 0;
+        if (!io(&ov, &transferred))
+        {
+            if (GetLastError() != ERROR_IO_PENDING || !GetOverlappedResult(hFile, &ov, &transferred, TRUE))
+            {
+                return 0;
+            }
+        }
+        return transferred;
+    }
+
+    static HANDLE OpenHandle(const std::wstring &path, DWORD access, DWORD disposition)
+    {
+        return CreateFileW(path.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           nullptr, disposition, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+    }
+
+    bool File::Open(const std::wstring &path, Mode mode)
+    {
+        Close();
+
+        DWORD access = mode == Mode::ReadWrite ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ;
+        HANDLE hFile = OpenHandle(path, access, OPEN_EXISTING);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        m_hFile = hFile;
+        return true;
+    }
+
+    bool File::Create(const std::wstring &path)
+    {
+        Close();
+
+        HANDLE hFile = OpenHandle(path, GENERIC_READ | GENERIC_WRITE, CREATE_ALWAYS);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        m_hFile = hFile;
+        return true;
+    }
+
+    void File::Close()
+    {
+        if (m_hFile)
+        {
+            CloseHandle(m_hFile);
+            m_hFile = nullptr;
+        }
+    }
+
+    bool File::IsOpen() const
+    {
+        return m_hFile != nullptr;
+    }
+
+    uint64_t File::Size() const
+    {
+        LARGE_INTEGER size;
+        if (!m_hFile || !GetFileSizeEx(m_hFile, &size))
+        {
+            return 0;
+        }
+        return static_cast<uint64_t>(size.QuadPart);
+    }
+
+    bool File::Resize(uint64_t size)
+    {
+        FILE_END_OF_FILE_INFO info = {};
+        info.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+        return m_hFile && SetFileInformationByHandle(m_hFile, FileEndOfFileInfo, &info, sizeof(info));
+    }
+
+    bool File::ReadAt(uint64_t offset, void *dst, size_t size) const
+    {
+        uint8_t *out = static_cast<uint8_t *>(dst);
+        while (size > 0)
+        {
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 0x40000000));
+            DWORD read = OverlappedIo(m_hFile, offset, [&](OVERLAPPED *ov, DWORD *transferred)
+                                      { return ReadFile(m_hFile, out, chunk, transferred, ov); });
+            if (read == 0)
+            {
+                return false;
+            }
+
+            out += read;
+            offset += read;
+            size -= read;
+        }
+        return true;
+    }
+
+    bool File::WriteAt(uint64_t offset, const void *src, size_t size)
+    {
+        const uint8_t *in = static_cast<const uint8_t *>(src);
+        while (size > 0)
+        {
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 0x40000000));
+            DWORD written = OverlappedIo(m_hFile, offset, [&](OVERLAPPED *ov, DWORD *transferred)
+                                         { return WriteFile(m_hFile, in, chunk, transferred, ov); });
+            if (written == 0)
+            {
+                return false;
+            }
+
+            in += written;
+            offset += written;
+            size -= written;
+        }
+        return true;
+    }
+
+#else
+
+    bool File::Open(const std::wstring &path, Mode mode)
+    {
+        Close();
+
+        int fd = ::open(std::filesystem::path(path).c_str(), mode == Mode::ReadWrite ? O_RDWR : O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        m_fd = fd;
+        return true;
+    }
+
+    bool File::Create(const std::wstring &path)
+    {
+        Close();
+
+        int fd = ::open(std::filesystem::path(path).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        m_fd = fd;
+        return true;
+    }
+
+    void File::Close()
+    {
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    bool File::IsOpen() const
+    {
+        return m_fd >= 0;
+    }
+
+    uint64_t File::Size() const
+    {
+        struct stat st;
+        if (m_fd < 0 || fstat(m_fd, &st) != 0)
+        {
+            return 0;
+        }
+        return static_cast<uint64_t>(st.st_size);
+    }
+
+    bool File::Resize(uint64_t size)
+    {
+        return m_fd >= 0 && ftruncate(m_fd, static_cast<off_t>(size)) == 0;
+    }
+
+    bool File::ReadAt(uint64_t offset, void *dst, size_t size) const
+    {
+        uint8_t *out = static_cast<uint8_t *>(dst);
+        while (size > 0)
+        {
+            ssize_t n = pread(m_fd, out, size, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+
+            out += n;
+            offset += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool File::WriteAt(uint64_t offset, const void *src, size_t size)
+    {
+        const uint8_t *in = static_cast<const uint8_t *>(src);
+        while (size > 0)
+        {
+            ssize_t n = pwrite(m_fd, in, size, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+
+            in += n;
+            offset += n;
+            size -= n;
+        }
+        return true;
+    }
+
+#endif
+
+    bool File::CopyRange(const File &src, uint64_t srcOffset, File &dst, uint64_t dstOffset, uint64_t size)
+    {
+#ifdef __linux__
+        // Cópia dentro do kernel; em sistemas de arquivos com reflink nem copia os blocos
+        while (size > 0)
+        {
+            loff_t in = static_cast<loff_t>(srcOffset);
+            loff_t out = static_cast<loff_t>(dstOffset);
+            ssize_t n = copy_file_range(src.m_fd, &in, dst.m_fd, &out, size, 0);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                break; // Sem suporte (kernel antigo, volumes diferentes): tenta sendfile
+            }
+
+            srcOffset += n;
+            dstOffset += n;
+            size -= n;
+        }
+
+        // sendfile escreve na posição corrente do destino
+        if (size > 0 && lseek(dst.m_fd, static_cast<off_t>(dstOffset), SEEK_SET) >= 0)
+        {
+            while (size > 0)
+            {
+                off_t in = static_cast<off_t>(srcOffset);
+                ssize_t n = sendfile(dst.m_fd, src.m_fd, &in, size);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    break;
+                }
+
+                srcOffset += n;
+                dstOffset += n;
+                size -= n;
+            }
+        }
+#endif
+
+        // Fallback: blocos grandes sequenciais
+        constexpr size_t COPY_CHUNK_SIZE = 4 * 1024 * 1024;
+        std::vector<uint8_t> buffer(static_cast<size_t>(std::min<uint64_t>(size, COPY_CHUNK_SIZE)));
+        while (size > 0)
+        {
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(size, buffer.size()));
+            if (!src.ReadAt(srcOffset, buffer.data(), chunk) || !dst.WriteAt(dstOffset, buffer.data(), chunk))
+            {
+                return false;
+            }
+
+            srcOffset += chunk;
+            dstOffset += chunk;
+            size -= chunk;
+        }
+        return true;
+    }
+
+    std::span<const uint8_t> MappedFile::View(uint64_t offset, size_t size) const
+    {
+        if (!m_data || offset > m_size || size > m_size - offset)
+        {
+            return {};
+        }
+
+        return {m_data + offset, size};
+    }
+
+    bool DirectoryCache::Ensure(const std::filesystem::path &dir)
+    {
+        std::wstring key = dir.wstring();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_created.count(key))
+            {
+                return true;
+            }
+        }
+
+        // Fora do lock: diretórios diferentes são criados em paralelo
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_created.insert(std::move(key));
+        return true;
+    }
+
+} // namespace autopatch
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <span>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <unordered_set>
+
+namespace autopatch
+{
+
+    // Mapeamento somente leitura de um arquivo inteiro em memória
+    // (file mapping no Windows, mmap em POSIX)
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        // Mapeia o arquivo inteiro
+        bool Open(const std::wstring &path);
+
+        // Desfaz o mapeamento
+        void Close();
+
+        // Verifica se está mapeado
+        bool IsOpen() const { return m_isOpen; }
+
+        // Acesso direto ao conteúdo
+        const uint8_t *Data() const { return m_data; }
+        uint64_t Size() const { return m_size; }
+
+        // View de [offset, offset + size); vazia se estiver fora do arquivo
+        std::span<const uint8_t> View(uint64_t offset, size_t size) const;
+
+    private:
+        const uint8_t *m_data = nullptr;
+        uint64_t m_size = 0;
+        bool m_isOpen = false;
+
+#ifdef _WIN32
+        void *m_hFile = nullptr;
+        void *m_hMapping = nullptr;
+#else
+        int m_fd = -1;
+#endif
+    };
+
+    // Arquivo com leitura/escrita posicional (sem posição compartilhada entre chamadas).
+    // ReadAt/WriteAt podem ser chamados de várias threads ao mesmo tempo no mesmo objeto
+    // (no Windows o handle é aberto com FILE_FLAG_OVERLAPPED para não serializar as leituras).
+    class File
+    {
+    public:
+        enum class Mode
+        {
+            Read,
+            ReadWrite
+        };
+
+        File();
+        ~File();
+
+        File(const File &) = delete;
+        File &operator=(const File &) = delete;
+
+        // Abre um arquivo existente
+        bool Open(const std::wstring &path, Mode mode = Mode::Read);
+
+        // Cria (ou trunca) o arquivo e abre para leitura/escrita
+        bool Create(const std::wstring &path);
+
+        // Fecha o arquivo
+        void Close();
+
+        // Verifica se está aberto
+        bool IsOpen() const;
+
+        // Tamanho atual do arquivo
+        uint64_t Size() const;
+
+        // Altera o tamanho do arquivo (trunca ou estende com zeros)
+        bool Resize(uint64_t size);
+
+        // Lê/escreve exatamente 'size' bytes em 'offset'
+        bool ReadAt(uint64_t offset, void *dst, size_t size) const;
+        bool WriteAt(uint64_t offset, const void *src, size_t size);
+
+        // Copia [srcOffset, srcOffset + size) de 'src' para 'dst' em 'dstOffset'.
+        // Usa copy_file_range/sendfile quando disponíveis (cópia dentro do kernel,
+        // ou reflink no mesmo volume) e leitura/escrita em blocos grandes nos demais casos.
+        static bool CopyRange(const File &src, uint64_t srcOffset, File &dst, uint64_t dstOffset, uint64_t size);
+
+    private:
+#ifdef _WIN32
+        void *m_hFile = nullptr;
+#else
+        int m_fd = -1;
+#endif
+    };
+
+    // Diretórios de destino de uma extração em paralelo (ExtractAll, ApplyToDisk): cada um
+    // é criado (com os pais) uma vez só, em vez de a cada arquivo. Seguro entre threads.
+    class DirectoryCache
+    {
+    public:
+        // Garante que 'dir' exista; já existir não é erro
+        bool Ensure(const std::filesystem::path &dir);
+
+    private:
+        std::mutex m_mutex;
+        std::unordered_set<std::wstring> m_created;
+    };
+
+} // namespace autopatch
@@ -1,7 +1,17 @@
 #include "grf.h"
+#include "grf_des.h"
+#include "grf_index_file.h"
+#include "codec.h"
 #include <zlib.h>
 #include <algorithm>
 #include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_set>
 #include <Windows.h>
 
 namespace autopatch
@@ -10,6 +20,66 @@ namespace autopatch
     // GRF signature
     static const char GRF_SIGNATURE[] = "Master of Magic";
 
+    // Header zlib válido (RFC 1950): método deflate, janela <= 32K, checksum do header
+    static bool IsZlibStream(const std::vector<uint8_t> &data)
+    {
+        if (data.size() < 6)
+        {
+            return false;
+        }
+
+        uint8_t cmf = data[0];
+        uint8_t flg = data[1];
+        return (cmf & 0x0F) == Z_DEFLATED && (cmf >> 4) <= 7 && (flg & 0x20) == 0 && ((cmf << 8) | flg) % 31 == 0;
+    }
+
+    // Envolve um stream deflate puro com header/trailer zlib sem recomprimir.
+    // O trailer exige o Adler-32 dos dados originais, então o stream é inflado
+    // (em blocos, sem guardar a saída) apenas para calcular o checksum e validar o tamanho.
+    static bool WrapRawDeflate(std::vector<uint8_t> &data, uint32_t uncompressedSize)
+    {
+        uint32_t adler = 0;
+        uint64_t totalOut = 0;
+        if (!CodecContext::ForThread().InflateChecksum(data.data(), data.size(), adler, totalOut) ||
+            totalOut != uncompressedSize)
+        {
+            return false;
+        }
+
+        // Header: deflate, janela 32K, nível padrão (0x78 0x9C)
+        data.insert(data.begin(), {0x78, 0x9C});
+        data.push_back(static_cast<uint8_t>(adler >> 24));
+        data.push_back(static_cast<uint8_t>(adler >> 16));
+        data.push_back(static_cast<uint8_t>(adler >> 8));
+        data.push_back(static_cast<uint8_t>(adler));
+        return true;
+    }
+
+    // Hash de 64 bits do conteúdo (8 bytes por passo, com o tamanho na semente). Só aponta
+    // candidatos para a deduplicação: a igualdade é sempre conferida byte a byte.
+    static uint64_t ContentHash(const uint8_t *data, size_t size)
+    {
+        constexpr uint64_t K = 0x9E3779B97F4A7C15ull;
+        uint64_t hash = (size + 1) * K;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            hash = (hash ^ word) * K;
+            hash ^= hash >> 32;
+        }
+
+        // Entrada vazia pode vir com data nulo: memcpy de nulo é indefinido mesmo com 0 bytes
+        uint64_t tail = 0;
+        if (size > i)
+        {
+            memcpy(&tail, data + i, size - i);
+        }
+        hash = (hash ^ tail) * K;
+        return hash ^ (hash >> 29);
+    }
+
     GrfFile::GrfFile() = default;
 
     GrfFile::~GrfFile()
@@ -17,23 +87,41 @@ namespace autopatch
         Close();
     }
 
-    bool GrfFile::Open(const std::wstring &path)
+    bool GrfFile::Open(const std::wstring &path, GrfOpenMode mode)
     {
         Close();
 
-        m_file.open(path, std::ios::in | std::ios::out | std::ios::binary);
-        if (!m_file.is_open())
+        if (mode == GrfOpenMode::ReadOnlyMapped)
         {
-            // Tenta abrir somente leitura
-            m_file.open(path, std::ios::in | std::ios::binary);
-            if (!m_file.is_open())
+            if (!m_mapped.Open(path))
             {
                 return false;
             }
         }
+        else
+        {
+            if (!m_file.Open(path, File::Mode::ReadWrite))
+            {
+                // Tenta abrir somente leitura
+                if (!m_file.Open(path, File::Mode::Read))
+                {
+                    return false;
+                }
+            }
+        }
 
         m_path = path;
 
+        if (m_mapped.IsOpen())
+        {
+            m_fileSize = m_mapped.Size();
+        }
+        else
+        {
+            m_fileSize = m_file.Size();
+        }
+        m_committedFileSize = m_fileSize;
+
         if (!ReadHeader())
         {
             Close();
@@ -46,6 +134,8 @@ namespace autopatch
             return false;
         }
 
+        BuildFreeSpace();
+
         m_isOpen = true;
         return true;
     }
@@ -54,8 +144,7 @@ namespace autopatch
     {
         Close();
 
-        m_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
-        if (!m_file.is_open())
+        if (!m_file.Create(path))
         {
             return false;
         }
@@ -69,7 +158,20 @@ namespace autopatch
         m_header.fileCount = 0;
         m_header.fileTableOffset = 46; // Tamanho do header
 
-        m_entries.clear();
+        m_index.Clear();
+        m_table.Clear();
+        m_states.clear();
+        m_sortedRows.clear();
+        m_space.Reset();
+        m_released.clear();
+        m_contentRows.clear();
+        m_blobRefs.clear();
+        m_dedupSavedBytes = 0;
+        m_dedupCount = 0;
+        m_tableRegionOffset = 0;
+        m_tableRegionSize = 0;
+        m_fileSize = 0;
+        m_committedFileSize = 0;
         m_isOpen = true;
         m_modified = true;
 
@@ -83,67 +185,138 @@ namespace autopatch
             Save();
         }
 
-        if (m_file.is_open())
+        m_file.Close();
+        m_mapped.Close();
+
+        // Com o GRF já fechado (data de modificação final)
+        if (m_indexDirty && !m_modified)
         {
-            m_file.close();
+            WriteIndexFile();
         }
 
         m_isOpen = false;
         m_modified = false;
-        m_entries.clear();
+        m_indexDirty = false;
+        m_tailBuffer = {};
+        m_tailOffset = 0;
+        m_index.Clear();
+        m_table.Clear();
+        m_states.clear();
+        m_sortedRows.clear();
+        m_space.Reset();
+        m_released.clear();
+        m_contentRows.clear();
+        m_blobRefs.clear();
+        m_dedupSavedBytes = 0;
+        m_dedupCount = 0;
+        m_tableRegionOffset = 0;
+        m_tableRegionSize = 0;
+        m_fileSize = 0;
+        m_committedFileSize = 0;
         m_path.clear();
     }
 
     bool GrfFile::ReadHeader()
     {
-        m_file.seekg(0);
+        uint8_t raw[46];
+        if (!ReadAt(0, raw, sizeof(raw)))
+        {
+            return false;
+        }
 
         // Lê signature
-        m_file.read(m_header.signature, 16);
+        memcpy(m_header.signature, raw, 16);
         if (memcmp(m_header.signature, GRF_SIGNATURE, 15) != 0)
         {
             return false; // Não é um GRF válido
         }
 
         // Lê encryption key
-        m_file.read(reinterpret_cast<char *>(m_header.encryptionKey), 14);
+        memcpy(m_header.encryptionKey, raw + 16, 14);
 
-        // Lê file table offset
-        m_file.read(reinterpret_cast<char *>(&m_header.fileTableOffset), 4);
+        // Lê version
+        uint32_t version;
+        memcpy(&version, raw + 42, 4);
+        m_header.version = static_cast<GrfVersion>(version);
 
-        // Lê seed
-        m_file.read(reinterpret_cast<char *>(&m_header.seed), 4);
+        // Lê file table offset e seed (0x300: offset de 8 bytes ocupa o lugar do seed)
+        if (m_header.version == GrfVersion::V0x300)
+        {
+            memcpy(&m_header.fileTableOffset, raw + 30, 8);
+            m_header.seed = 0;
+        }
+        else
+        {
+            uint32_t tableOffset;
+            memcpy(&tableOffset, raw + 30, 4);
+            m_header.fileTableOffset = tableOffset;
+            memcpy(&m_header.seed, raw + 34, 4);
+        }
 
         // Lê file count (real count = stored - seed - 7)
         uint32_t storedCount;
-        m_file.read(reinterpret_cast<char *>(&storedCount), 4);
-
-        // Lê version
-        uint32_t version;
-        m_file.read(reinterpret_cast<char *>(&version), 4);
-        m_header.version = static_cast<GrfVersion>(version);
+        memcpy(&storedCount, raw + 38, 4);
 
         // Calcula file count real
         m_header.fileCount = storedCount - m_header.seed - 7;
 
-        return m_file.good();
+        return true;
     }
 
     bool GrfFile::ReadFileTable()
     {
-        m_entries.clear();
+        m_index.Clear();
+        m_table.Clear();
+        m_states.clear();
+        m_sortedRows.clear();
+        m_contentRows.clear();
+
+        // GRFs 0x1xx têm tabela sem compressão e nomes encriptados
+        if ((static_cast<uint32_t>(m_header.version) & 0xFF00) == 0x100)
+        {
+            return ReadLegacyFileTable();
+        }
+
+        m_tableRegionOffset = m_header.fileTableOffset;
+
+        // Índice persistido: validado só pelo header e pelo tamanho/data do GRF, sem ler a tabela
+        if (m_useIndexFile)
+        {
+            GrfIndexKey key;
+            key.grfVersion = static_cast<uint32_t>(m_header.version);
+            key.tableOffset = m_tableRegionOffset;
+            key.fileCount = m_header.fileCount;
+            if (GrfIndexFileStat(m_path, key.grfSize, key.grfMtime) &&
+                LoadGrfIndexFile(m_path + L".idx", key, m_tableRegionSize, m_index, m_table))
+            {
+                OutputDebugStringA(("[GRF] Tabela carregada do índice: " + std::to_string(m_table.Size()) + " entradas\n").c_str());
+                return true;
+            }
+            m_index.Clear();
+            m_table.Clear();
+            m_indexDirty = true;
+        }
 
-        // Vai para a tabela de arquivos
-        m_file.seekg(m_header.fileTableOffset + 46); // 46 = tamanho do header
+        // Vai para a tabela de arquivos (46 = tamanho do header)
+        uint64_t tablePos = static_cast<uint64_t>(m_header.fileTableOffset) + 46;
 
         // Lê tamanho comprimido e descomprimido da tabela
-        uint32_t compressedSize, uncompressedSize;
-        m_file.read(reinterpret_cast<char *>(&compressedSize), 4);
-        m_file.read(reinterpret_cast<char *>(&uncompressedSize), 4);
+        uint32_t sizes[2];
+        if (!ReadAt(tablePos, sizes, sizeof(sizes)))
+        {
+            return false;
+        }
+        uint32_t compressedSize = sizes[0];
+        uint32_t uncompressedSize = sizes[1];
+
+        m_tableRegionSize = 8ull + compressedSize;
 
         // Lê dados comprimidos
         std::vector<uint8_t> compressedData(compressedSize);
-        m_file.read(reinterpret_cast<char *>(compressedData.data()), compressedSize);
+        if (!ReadAt(tablePos + 8, compressedData.data(), compressedSize))
+        {
+            return false;
+        }
 
         // Descomprime
         auto tableData = Decompress(compressedData, uncompressedSize);
@@ -152,347 +325,1857 @@ namespace autopatch
             return false;
         }
 
-        // Parse das entradas
+        // 0x300 grava o offset de cada entrada com 8 bytes
+        return ParseGrfFileTable(tableData.data(), tableData.size(), m_header.fileCount,
+                                 m_header.version == GrfVersion::V0x300, m_index, m_table);
+    }
+
+    bool GrfFile::ReadLegacyFileTable()
+    {
+        /**
+         * Tabela 0x1xx (sem compressão, do offset da tabela até o fim do arquivo):
+         *   u32 tamanho do nome, u8[2], nome encriptado, ...
+         *   u32 compSize (+declen+715), u32 alignedSize (+37579), u32 uncompSize, u8 flags, u32 offset
+         *
+         * Os tamanhos são desofuscados e as flags de encriptação derivadas da extensão,
+         * ficando equivalentes às de uma tabela 0x200. Ao salvar, o arquivo passa a 0x200.
+         */
+        uint64_t tablePos = static_cast<uint64_t>(m_header.fileTableOffset) + 46;
+        if (tablePos > m_fileSize)
+        {
+            return false;
+        }
+
+        m_tableRegionOffset = m_header.fileTableOffset;
+        m_tableRegionSize = m_fileSize - tablePos;
+
+        std::vector<uint8_t> tableData(static_cast<size_t>(m_tableRegionSize));
+        if (!ReadAt(tablePos, tableData.data(), tableData.size()))
+        {
+            return false;
+        }
+
+        auto readU32 = [&](size_t at)
+        {
+            uint32_t value;
+            memcpy(&value, &tableData[at], 4);
+            return value;
+        };
+
+        m_index.Reserve(m_header.fileCount);
+        m_table.Reserve(m_header.fileCount);
+
         size_t pos = 0;
         for (uint32_t i = 0; i < m_header.fileCount; i++)
         {
-            GrfEntry entry;
-
-            // Lê nome do arquivo (null-terminated)
-            entry.filename = reinterpret_cast<const char *>(&tableData[pos]);
-            pos += entry.filename.length() + 1;
+            if (pos + 6 > tableData.size())
+            {
+                return false;
+            }
 
-            // Lê dados da entrada (depende da versão)
-            if (m_header.version == GrfVersion::V0x200)
+            size_t infoPos = pos + readU32(pos) + 4;
+            if (infoPos + 17 > tableData.size() || infoPos < pos + 6)
             {
-                memcpy(&entry.compressedSize, &tableData[pos], 4);
-                pos += 4;
-                memcpy(&entry.compressedSizeAligned, &tableData[pos], 4);
-                pos += 4;
-                memcpy(&entry.uncompressedSize, &tableData[pos], 4);
-                pos += 4;
-                entry.flags = tableData[pos++];
-                memcpy(&entry.offset, &tableData[pos], 4);
-                pos += 4;
+                return false;
             }
-            else
+
+            uint8_t flags = tableData[infoPos + 12];
+            if (flags & GRFFILE_FLAG_FILE)
             {
-                // Versões antigas
-                memcpy(&entry.compressedSize, &tableData[pos], 4);
-                pos += 4;
-                memcpy(&entry.compressedSizeAligned, &tableData[pos], 4);
-                pos += 4;
-                memcpy(&entry.uncompressedSize, &tableData[pos], 4);
-                pos += 4;
-                entry.flags = tableData[pos++];
-                memcpy(&entry.offset, &tableData[pos], 4);
-                pos += 4;
-
-                // Calcula cycle para DES
-                if (entry.flags & GRFFILE_FLAG_MIXCRYPT)
+                size_t nameLength = tableData[pos] >= 6 ? tableData[pos] - 6 : 0;
+                nameLength = std::min(nameLength, infoPos - (pos + 6));
+                GrfDecodeLegacyName(&tableData[pos + 6], nameLength);
+
+                const char *rawName = reinterpret_cast<const char *>(&tableData[pos + 6]);
+                std::string_view filename(rawName, strnlen(rawName, nameLength));
+
+                // .gnd/.gat/.act/.str só têm o cabeçalho encriptado; o resto usa o modo misto
+                bool headerOnly = false;
+                if (filename.size() >= 4)
+                {
+                    std::string_view ext = filename.substr(filename.size() - 4);
+                    headerOnly = GrfNameEquals(ext, ".gnd") || GrfNameEquals(ext, ".gat") ||
+                                 GrfNameEquals(ext, ".act") || GrfNameEquals(ext, ".str");
+                }
+                flags |= headerOnly ? GRFFILE_FLAG_DES : GRFFILE_FLAG_MIXCRYPT;
+
+                bool inserted;
+                uint32_t row = m_index.FindOrInsert(filename, inserted);
+                if (row == GrfNameIndex::npos)
                 {
-                    entry.cycle = 1;
-                    for (size_t j = 10; entry.compressedSize >= j; j *= 10)
-                    {
-                        entry.cycle++;
-                    }
+                    return false;
                 }
+                if (inserted)
+                {
+                    m_table.Append();
+                }
+
+                uint32_t uncompressedSize = readU32(infoPos + 8);
+                m_table.compressedSize[row] = readU32(infoPos) - uncompressedSize - 715;
+                m_table.compressedSizeAligned[row] = readU32(infoPos + 4) - 37579;
+                m_table.uncompressedSize[row] = uncompressedSize;
+                m_table.flags[row] = flags;
+                m_table.offset[row] = readU32(infoPos + 13);
             }
 
-            m_entries[entry.filename] = entry;
+            pos = infoPos + 17;
         }
 
+        OutputDebugStringA(("[GRF] Tabela 0x1xx lida: " + std::to_string(m_table.Size()) + " arquivos\n").c_str());
         return true;
     }
 
-    std::vector<std::string> GrfFile::GetFileList() const
+    const GrfFile::EntryState *GrfFile::FindState(uint32_t row) const
     {
-        std::vector<std::string> list;
-        list.reserve(m_entries.size());
-
-        for (const auto &[name, entry] : m_entries)
+        if (m_states.empty())
         {
-            list.push_back(name);
+            return nullptr;
         }
 
-        return list;
+        auto it = m_states.find(row);
+        return it != m_states.end() ? &it->second : nullptr;
     }
 
-    bool GrfFile::FileExists(const std::string &filename) const
+    bool GrfFile::IsDeleted(uint32_t row) const
     {
-        return m_entries.find(filename) != m_entries.end();
+        auto state = FindState(row);
+        return state && state->isDeleted;
     }
 
-    const GrfEntry *GrfFile::GetEntry(const std::string &filename) const
+    bool GrfFile::IsCommitted(uint32_t row) const
     {
-        auto it = m_entries.find(filename);
-        if (it != m_entries.end())
-        {
-            return &it->second;
-        }
-        return nullptr;
+        // Dados da linha estão no arquivo e são referenciados pela tabela gravada
+        auto state = FindState(row);
+        return !state || !(state->isNew || state->isModified || state->isDeleted);
     }
 
-    std::vector<uint8_t> GrfFile::ExtractFile(const std::string &filename)
+    void GrfFile::BuildFreeSpace()
     {
-        auto entry = GetEntry(filename);
-        if (!entry || !(entry->flags & GRFFILE_FLAG_FILE))
+        std::vector<std::pair<uint64_t, uint64_t>> used;
+        used.reserve(m_table.Size() + 1);
+
+        for (uint32_t row = 0; row < m_table.Size(); row++)
         {
-            return {};
+            if (IsCommitted(row))
+            {
+                used.emplace_back(m_table.offset[row], m_table.compressedSizeAligned[row]);
+            }
         }
 
-        // Lê dados comprimidos
-        m_file.seekg(entry->offset + 46);
-        std::vector<uint8_t> compressedData(entry->compressedSizeAligned);
-        m_file.read(reinterpret_cast<char *>(compressedData.data()), entry->compressedSizeAligned);
-
-        // Decripta se necessário
-        DecryptEntry(compressedData, *entry);
+        // A tabela gravada fica reservada até ser substituída
+        used.emplace_back(m_tableRegionOffset, m_tableRegionSize);
 
-        // Redimensiona para tamanho real
-        compressedData.resize(entry->compressedSize);
-
-        // Se não está comprimido, retorna diretamente
-        if (entry->compressedSize == entry->uncompressedSize)
+        // Linhas que apontam para o mesmo offset compartilham os dados (deduplicação ou
+        // GRFs gerados por outras ferramentas): a região só é liberada com a última
+        m_blobRefs.clear();
+        std::vector<uint64_t> offsets;
+        offsets.reserve(used.size());
+        for (size_t i = 0; i + 1 < used.size(); i++)
+        {
+            if (used[i].second > 0)
+            {
+                offsets.push_back(used[i].first);
+            }
+        }
+        std::sort(offsets.begin(), offsets.end());
+        for (size_t i = 1; i < offsets.size(); i++)
         {
-            return compressedData;
+            if (offsets[i] == offsets[i - 1])
+            {
+                AddBlobRef(offsets[i]);
+            }
         }
 
-        // Descomprime
-        return Decompress(compressedData, entry->uncompressedSize);
+        m_space.Build(std::move(used));
+        m_released.clear();
+
+        OutputDebugStringA(("[GRF] Espaço livre: " + std::to_string(m_space.FreeBytes()) + " bytes em " +
+                            std::to_string(m_space.HoleCount()) + " buracos\n")
+                               .c_str());
     }
 
-    bool GrfFile::ExtractFileTo(const std::string &filename, const std::wstring &outputPath)
+    void GrfFile::ReleaseCommittedData(uint32_t row)
     {
-        auto data = ExtractFile(filename);
-        if (data.empty())
-        {
-            return false;
-        }
-
-        std::ofstream file(outputPath, std::ios::binary);
-        if (!file.is_open())
+        // Não reutiliza antes do commit: a tabela antiga ainda aponta para estes bytes
+        if (IsCommitted(row) && m_table.compressedSizeAligned[row] > 0)
         {
-            return false;
+            // Região compartilhada: outras linhas continuam usando os bytes
+            auto it = m_blobRefs.find(m_table.offset[row]);
+            if (it != m_blobRefs.end())
+            {
+                if (--it->second <= 1)
+                {
+                    m_blobRefs.erase(it);
+                }
+                return;
+            }
+            m_released.emplace_back(m_table.offset[row], m_table.compressedSizeAligned[row]);
         }
-
-        file.write(reinterpret_cast<const char *>(data.data()), data.size());
-        return true;
     }
 
-    bool GrfFile::AddFile(const std::string &filename, const std::vector<uint8_t> &data)
+    void GrfFile::AddBlobRef(uint64_t offset)
     {
-        OutputDebugStringA(("[GRF] AddFile: " + filename + " (" + std::to_string(data.size()) + " bytes)\n").c_str());
+        // Regiões sem entrada no mapa têm uma única referência
+        auto [it, inserted] = m_blobRefs.try_emplace(offset, 1);
+        it->second++;
+    }
 
-        // Comprime os dados
-        auto compressed = Compress(data);
-        if (compressed.empty() && !data.empty())
+    void GrfFile::CommitFreeSpace(uint64_t tableOffset, uint64_t tableSize)
+    {
+        // Nova tabela e header gravados: regiões antigas passam a ser buracos
+        for (const auto &[offset, size] : m_released)
         {
-            OutputDebugStringA("[GRF] ERRO: Falha na compressão\n");
-            return false;
+            m_space.Free(offset, size);
         }
+        m_released.clear();
 
-        // Verifica se arquivo já existe
-        bool exists = m_entries.find(filename) != m_entries.end();
-
-        // Cria/atualiza entrada
-        GrfEntry entry;
-        entry.filename = filename;
-        entry.uncompressedSize = static_cast<uint32_t>(data.size());
-        entry.compressedSize = static_cast<uint32_t>(compressed.size());
-        entry.compressedSizeAligned = (entry.compressedSize + 7) & ~7; // Alinha para 8 bytes
-        entry.flags = GRFFILE_FLAG_FILE;
-        entry.isNew = !exists;
-        entry.isModified = exists;
-        entry.isDeleted = false;
-        entry.cachedData = std::move(compressed);
-
-        // Padding para alinhamento
-        entry.cachedData.resize(entry.compressedSizeAligned, 0);
-
-        m_entries[filename] = std::move(entry);
-        m_modified = true;
-
-        OutputDebugStringA(("[GRF] Arquivo adicionado: " + filename +
-                            " (compressed: " + std::to_string(entry.compressedSize) +
-                            ", aligned: " + std::to_string(entry.compressedSizeAligned) + ")\n")
-                               .c_str());
-        return true;
+        m_space.Free(m_tableRegionOffset, m_tableRegionSize);
+        m_tableRegionOffset = tableOffset;
+        m_tableRegionSize = tableSize;
     }
 
-    bool GrfFile::AddFile(const std::string &filename, const std::wstring &sourcePath)
+    GrfSpaceStats GrfFile::GetSpaceStats() const
     {
-        std::ifstream file(sourcePath, std::ios::binary | std::ios::ate);
-        if (!file.is_open())
+        GrfSpaceStats stats;
+        stats.fileSize = m_fileSize;
+        stats.tableBytes = m_tableRegionSize;
+        stats.holeBytes = m_space.FreeBytes();
+        stats.holeCount = m_space.HoleCount();
+        stats.largestHole = m_space.LargestHole();
+
+        std::unordered_set<uint64_t> shared;
+        for (uint32_t row = 0; row < m_table.Size(); row++)
         {
-            return false;
+            // Região compartilhada conta uma vez
+            if (IsCommitted(row) && (!m_blobRefs.count(m_table.offset[row]) || shared.insert(m_table.offset[row]).second))
+            {
+                stats.liveBytes += m_table.compressedSizeAligned[row];
+            }
         }
 
-        size_t size = file.tellg();
-        file.seekg(0);
+        for (const auto &[offset, size] : m_released)
+        {
+            stats.pendingBytes += size;
+        }
 
-        std::vector<uint8_t> data(size);
-        file.read(reinterpret_cast<char *>(data.data()), size);
+        uint64_t dataEnd = 46 + m_space.End();
+        if (m_fileSize > dataEnd)
+        {
+            stats.trailingBytes = m_fileSize - dataEnd;
+        }
 
-        return AddFile(filename, data);
+        return stats;
     }
 
-    bool GrfFile::RemoveFile(const std::string &filename)
+    GrfEntry GrfFile::MakeEntry(uint32_t row) const
     {
-        auto it = m_entries.find(filename);
-        if (it == m_entries.end())
+        GrfEntry entry;
+        entry.filename = m_index.Name(row);
+        entry.compressedSize = m_table.compressedSize[row];
+        entry.compressedSizeAligned = m_table.compressedSizeAligned[row];
+        entry.uncompressedSize = m_table.uncompressedSize[row];
+        entry.offset = m_table.offset[row];
+        entry.flags = m_table.flags[row];
+
+        // Calcula cycle para DES
+        entry.cycle = 0;
+        if (entry.flags & GRFFILE_FLAG_MIXCRYPT)
         {
-            return false;
+            entry.cycle = GrfDesCycle(entry.compressedSize);
         }
 
-        // Marca como deletado em vez de remover
-        it->second.isDeleted = true;
-        m_modified = true;
-        return true;
+        auto state = FindState(row);
+        entry.isNew = state && state->isNew;
+        entry.isModified = state && state->isModified;
+        entry.isDeleted = state && state->isDeleted;
+        return entry;
     }
 
-    bool GrfFile::Save()
+    std::vector<std::string> GrfFile::GetFileList() const
     {
-        OutputDebugStringA("[GRF] Iniciando Save (QuickMerge)...\n");
-
-        if (!m_isOpen || !m_file.is_open())
-        {
-            OutputDebugStringA("[GRF] ERRO: Arquivo não está aberto\n");
-            return false;
-        }
+        std::vector<std::string> list;
+        list.reserve(m_table.Size());
 
-        if (!m_modified)
+        for (uint32_t row = 0; row < m_table.Size(); row++)
         {
-            OutputDebugStringA("[GRF] Nenhuma modificação pendente\n");
-            return true;
+            list.emplace_back(m_index.Name(row));
         }
 
-        // QuickMerge: Escreve apenas arquivos novos/modificados ao final
-        if (!WriteFileData())
-        {
-            OutputDebugStringA("[GRF] ERRO: Falha ao escrever dados\n");
-            return false;
-        }
+        return list;
+    }
 
-        // Atualiza contagem de arquivos
-        uint32_t fileCount = 0;
-        for (const auto &[name, entry] : m_entries)
+    void GrfFile::ForEachFile(const GrfFileVisitor &visit) const
+    {
+        for (uint32_t row = 0; row < m_table.Size(); row++)
         {
-            if (!entry.isDeleted)
+            if (!IsDeleted(row) && !visit(m_index.Name(row)))
             {
-                fileCount++;
+                return;
             }
         }
-        m_header.fileCount = fileCount;
+    }
 
-        // Escreve tabela de arquivos
-        if (!WriteFileTable())
-        {
-            OutputDebugStringA("[GRF] ERRO: Falha ao escrever tabela de arquivos\n");
-            return false;
-        }
+    const std::vector<uint32_t> &GrfFile::SortedRows() const
+    {
+        std::lock_guard<std::mutex> lock(m_sortedMutex);
 
-        // Escreve header atualizado
-        if (!WriteHeader())
+        size_t sorted = m_sortedRows.size();
+        if (sorted == m_table.Size())
         {
-            OutputDebugStringA("[GRF] ERRO: Falha ao escrever header\n");
-            return false;
+            return m_sortedRows;
         }
 
-        // Flush
-        m_file.flush();
+        auto less = [this](uint32_t a, uint32_t b)
+        {
+            return GrfNameCompare(m_index.Name(a), m_index.Name(b)) < 0;
+        };
 
-        m_modified = false;
-        OutputDebugStringA(("[GRF] Save concluído com sucesso. Arquivos: " + std::to_string(fileCount) + "\n").c_str());
-        return true;
+        // Só as linhas acrescentadas desde a última consulta são ordenadas e intercaladas
+        for (uint32_t row = static_cast<uint32_t>(sorted); row < m_table.Size(); row++)
+        {
+            m_sortedRows.push_back(row);
+        }
+        std::sort(m_sortedRows.begin() + sorted, m_sortedRows.end(), less);
+        std::inplace_merge(m_sortedRows.begin(), m_sortedRows.begin() + sorted, m_sortedRows.end(), less);
+        return m_sortedRows;
     }
 
-    bool GrfFile::WriteFileData()
+    size_t GrfFile::FindFiles(std::string_view pattern, const GrfFileVisitor &visit) const
     {
-        /**
-         * QuickMerge Implementation
-         *
-         * Estratégia:
-         * 1. Encontrar onde termina o último arquivo existente (não deletado, não novo)
-         * 2. Escrever novos/modificados ao final
-         * 3. Atualizar offsets das entradas
-         */
+        const std::vector<uint32_t> &rows = SortedRows();
+
+        // Prefixo literal: todos os candidatos ficam num trecho contíguo da ordem
+        std::string_view prefix = pattern.substr(0, std::min(pattern.find_first_of("*?"), pattern.size()));
+        bool literal = prefix.size() == pattern.size();
 
-        // Passo 1: Encontrar onde termina o último arquivo existente
-        uint64_t endOffset = 0;
+        auto first = std::lower_bound(rows.begin(), rows.end(), prefix, [this](uint32_t row, std::string_view key)
+                                      { return GrfNameCompare(m_index.Name(row), key) < 0; });
 
-        for (const auto &[name, entry] : m_entries)
+        size_t matched = 0;
+        for (auto it = first; it != rows.end(); ++it)
         {
-            // Ignorar arquivos deletados ou novos/modificados (serão escritos ao final)
-            if (entry.isDeleted || entry.isNew || entry.isModified)
+            std::string_view name = m_index.Name(*it);
+            if (!GrfNameStartsWith(name, prefix) || (literal && name.size() != prefix.size()))
+            {
+                break;
+            }
+            if (IsDeleted(*it) || (!literal && !GrfNameMatch(name, pattern)))
             {
                 continue;
             }
 
-            // Calcular onde termina este arquivo
-            uint64_t entryEnd = entry.offset + entry.compressedSizeAligned;
-            if (entryEnd > endOffset)
+            matched++;
+            if (!visit(name))
             {
-                endOffset = entryEnd;
+                break;
             }
         }
+        return matched;
+    }
 
-        OutputDebugStringA(("[GRF] Offset final de arquivos existentes: " + std::to_string(endOffset) + "\n").c_str());
+    std::vector<std::string_view> GrfFile::FindFiles(std::string_view pattern) const
+    {
+        std::vector<std::string_view> names;
+        FindFiles(pattern, [&](std::string_view name)
+                  {
+                      names.push_back(name);
+                      return true; });
+        return names;
+    }
 
-        // Passo 2: Escrever arquivos novos/modificados ao final
-        uint64_t writeOffset = endOffset;
-        int writtenCount = 0;
+    bool GrfFile::FileExists(const std::string &filename) const
+    {
+        return m_index.Find(filename) != GrfNameIndex::npos;
+    }
 
-        for (auto &[name, entry] : m_entries)
+    std::optional<GrfEntry> GrfFile::GetEntry(const std::string &filename) const
+    {
+        uint32_t row = m_index.Find(filename);
+        if (row != GrfNameIndex::npos)
         {
-            if (entry.isDeleted)
-            {
-                continue;
-            }
+            return MakeEntry(row);
+        }
+        return std::nullopt;
+    }
 
-            // Apenas processar novos ou modificados
-            if (!entry.isNew && !entry.isModified)
-            {
-                continue;
-            }
+    std::vector<std::optional<GrfEntry>> GrfFile::GetEntries(const std::vector<std::string> &filenames) const
+    {
+        std::vector<std::string_view> names(filenames.begin(), filenames.end());
+        std::vector<uint32_t> rows(names.size());
+        m_index.FindMany(names.data(), names.size(), rows.data());
 
-            if (entry.cachedData.empty())
+        std::vector<std::optional<GrfEntry>> result(rows.size());
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            if (rows[i] != GrfNameIndex::npos)
             {
-                OutputDebugStringA(("[GRF] AVISO: Dados vazios para: " + name + "\n").c_str());
-                continue;
+                result[i] = MakeEntry(rows[i]);
             }
+        }
+        return result;
+    }
 
-            // Posicionar e escrever (offset é relativo ao fim do header, que tem 46 bytes)
-            m_file.seekp(static_cast<std::streamoff>(46 + writeOffset));
-            m_file.write(reinterpret_cast<const char *>(entry.cachedData.data()), entry.cachedData.size());
+    GrfMemoryStats GrfFile::GetMemoryStats() const
+    {
+        // Estimativa de nó de unordered_map: ponteiro + hash + chave/valor
+        constexpr size_t NODE_OVERHEAD = 2 * sizeof(void *);
 
-            if (!m_file)
-            {
-                OutputDebugStringA(("[GRF] ERRO: Falha ao escrever: " + name + "\n").c_str());
-                return false;
-            }
+        GrfMemoryStats stats;
+        stats.entryCount = m_table.Size();
+        stats.tableBytes = m_table.MemoryUsage();
+        stats.indexBytes = m_index.IndexMemoryUsage();
+        stats.nameBytes = m_index.NameMemoryUsage();
 
-            // Atualizar offset da entrada
-            entry.offset = static_cast<uint32_t>(writeOffset);
-            entry.isNew = false;
-            entry.isModified = false;
+        stats.overlayBytes = m_states.size() * (sizeof(EntryState) + sizeof(uint32_t) + NODE_OVERHEAD);
+        for (const auto &[row, state] : m_states)
+        {
+            stats.overlayBytes += state.cachedData.capacity();
+        }
+        return stats;
+    }
 
-            OutputDebugStringA(("[GRF] Escrito: " + name + " @ offset " + std::to_string(writeOffset) + "\n").c_str());
+    std::vector<uint8_t> GrfFile::ExtractFile(const std::string &filename) const
+    {
+        std::vector<uint8_t> data;
+        ExtractInto(filename, data);
+        return data;
+    }
 
-            // Avançar offset
-            writeOffset += entry.cachedData.size();
-            writtenCount++;
+    bool GrfFile::ExtractInto(const std::string &filename, std::vector<uint8_t> &out) const
+    {
+        std::span<const uint8_t> view;
+        if (!ReadEntry(filename, out, view))
+        {
+            out.clear();
+            return false;
+        }
+
+        // View direta do mapeamento: copia para 'out' (reaproveitando a capacidade)
+        if (view.data() != out.data())
+        {
+            out.assign(view.begin(), view.end());
+        }
+        return true;
+    }
+
+    std::span<const uint8_t> GrfFile::ExtractView(const std::string &filename, std::vector<uint8_t> &buffer) const
+    {
+        std::span<const uint8_t> view;
+        if (!ReadEntry(filename, buffer, view))
+        {
+            return {};
+        }
+        return view;
+    }
+
+    bool GrfFile::ReadEntry(const std::string &filename, std::vector<uint8_t> &buffer, std::span<const uint8_t> &view) const
+    {
+        uint32_t row = m_index.Find(filename);
+        if (row == GrfNameIndex::npos || !(m_table.flags[row] & GRFFILE_FLAG_FILE))
+        {
+            return false;
+        }
+
+        uint32_t compressedSize = m_table.compressedSize[row];
+        uint32_t uncompressedSize = m_table.uncompressedSize[row];
+        uint64_t offset = m_table.offset[row] + 46ull;
+        uint8_t flags = m_table.flags[row];
+
+        // Se não está comprimido, os dados são retornados diretamente
+        bool stored = compressedSize == uncompressedSize;
+
+        // Entrada ainda não salva: dados comprimidos estão em memória
+        auto state = FindState(row);
+        if (state && !state->cachedData.empty())
+        {
+            if (!Decompress(state->cachedData.data(), compressedSize, uncompressedSize, buffer))
+            {
+                return false;
+            }
+            view = buffer;
+            return true;
+        }
+
+        // Modo mapeado: lê direto do mapeamento, sem cópia intermediária
+        bool encrypted = (flags & (GRFFILE_FLAG_MIXCRYPT | GRFFILE_FLAG_DES)) != 0;
+        if (m_mapped.IsOpen() && !encrypted)
+        {
+            auto raw = m_mapped.View(offset, compressedSize);
+            if (raw.size() != compressedSize)
+            {
+                return false;
+            }
+
+            if (stored)
+            {
+                view = raw;
+                return true;
+            }
+
+            if (!Decompress(raw.data(), raw.size(), uncompressedSize, buffer))
+            {
+                return false;
+            }
+            view = buffer;
+            return true;
+        }
+
+        // Armazenado sem compressão: lê direto no buffer de saída
+        if (stored)
+        {
+            buffer.resize(m_table.compressedSizeAligned[row]);
+            if (!ReadAt(offset, buffer.data(), buffer.size()))
+            {
+                return false;
+            }
+            DecryptEntry(buffer, flags, compressedSize);
+            buffer.resize(compressedSize);
+            view = buffer;
+            return true;
+        }
+
+        // Lê dados comprimidos num buffer do pool da thread
+        BufferPool &pool = CodecContext::ForThread().Buffers();
+        std::vector<uint8_t> compressedData = pool.Acquire(m_table.compressedSizeAligned[row]);
+        bool ok = ReadAt(offset, compressedData.data(), compressedData.size());
+        if (ok)
+        {
+            // Decripta se necessário
+            DecryptEntry(compressedData, flags, compressedSize);
+
+            // Descomprime
+            ok = Decompress(compressedData.data(), compressedSize, uncompressedSize, buffer);
+        }
+        pool.Release(std::move(compressedData));
+
+        if (!ok)
+        {
+            return false;
+        }
+        view = buffer;
+        return true;
+    }
+
+    bool GrfFile::ExtractFileTo(const std::string &filename, const std::wstring &outputPath) const
+    {
+        auto data = ExtractFile(filename);
+        if (data.empty())
+        {
+            return false;
+        }
+
+        std::ofstream file(outputPath, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char *>(data.data()), data.size());
+        return true;
+    }
+
+    bool GrfFile::ExtractAll(const std::wstring &outputDir, const GrfExtractProgress &progress, ThreadPool *pool) const
+    {
+        /**
+         * Pipeline de extração
+         *
+         * 1. Leitor (thread dedicada): percorre as entradas em ordem de offset e lê os
+         *    bytes comprimidos de cada lote para uma arena contígua (leitura sequencial)
+         * 2. Pool: cada entrada do lote é decriptada, descomprimida e gravada no disco
+         *    pela mesma tarefa (o buffer descomprimido não troca de thread)
+         *
+         * Dois lotes se alternam: enquanto o pool processa um, o leitor enche o outro.
+         * Diretórios já criados ficam num cache compartilhado.
+         */
+        if (!m_isOpen)
+        {
+            return false;
+        }
+
+        ThreadPool &workers = pool ? *pool : ThreadPool::Default();
+
+        // Entradas vivas em ordem física
+        std::vector<uint32_t> rows;
+        rows.reserve(m_table.Size());
+        for (uint32_t row = 0; row < m_table.Size(); row++)
+        {
+            if ((m_table.flags[row] & GRFFILE_FLAG_FILE) && !IsDeleted(row))
+            {
+                rows.push_back(row);
+            }
+        }
+        std::sort(rows.begin(), rows.end(), [this](uint32_t a, uint32_t b)
+                  { return m_table.offset[a] < m_table.offset[b]; });
+
+        OutputDebugStringA(("[GRF] ExtractAll: " + std::to_string(rows.size()) + " arquivos\n").c_str());
+
+        struct Batch
+        {
+            size_t first = 0;                         // Índice em 'rows'
+            size_t count = 0;                         // Entradas no lote
+            std::vector<uint8_t> arena;               // Bytes lidos do arquivo
+            std::vector<std::span<const uint8_t>> views; // Dados comprimidos de cada entrada
+            std::vector<uint8_t> readOk;
+        };
+
+        constexpr uint64_t BATCH_BYTES = 32 * 1024 * 1024;
+        constexpr size_t BATCH_FILES = 4096;
+
+        Batch batches[2];
+        std::mutex queueMutex;
+        std::condition_variable queueCv;
+        Batch *ready = nullptr;    // Lote cheio aguardando o pool
+        Batch *idle = &batches[1]; // Lote livre para o leitor
+        bool readerDone = false;
+        std::atomic<bool> cancelled{false};
+
+        // Estágio 1: leitura em ordem de offset
+        auto fill = [&](Batch &batch, size_t first)
+        {
+            batch.first = first;
+            batch.count = 0;
+
+            // Tamanho do lote: entradas que precisam ser lidas para a arena
+            uint64_t arenaSize = 0;
+            size_t end = first;
+            while (end < rows.size() && end - first < BATCH_FILES)
+            {
+                uint32_t row = rows[end];
+                auto state = FindState(row);
+                bool inMemory = state && !state->cachedData.empty();
+                bool encrypted = (m_table.flags[row] & (GRFFILE_FLAG_MIXCRYPT | GRFFILE_FLAG_DES)) != 0;
+                uint64_t size = (inMemory || (m_mapped.IsOpen() && !encrypted)) ? 0 : m_table.compressedSizeAligned[row];
+                if (end > first && arenaSize + size > BATCH_BYTES)
+                {
+                    break;
+                }
+                arenaSize += size;
+                end++;
+            }
+
+            batch.count = end - first;
+            ReadRows(rows.data() + first, batch.count, batch.arena, batch.views, batch.readOk);
+        };
+
+        std::thread reader([&]()
+                           {
+                               Batch *current = &batches[0];
+                               size_t next = 0;
+                               while (next < rows.size() && !cancelled)
+                               {
+                                   fill(*current, next);
+                                   next += current->count;
+
+                                   std::unique_lock<std::mutex> lock(queueMutex);
+                                   queueCv.wait(lock, [&]()
+                                                { return ready == nullptr || cancelled; });
+                                   if (cancelled)
+                                   {
+                                       break;
+                                   }
+                                   ready = current;
+                                   queueCv.notify_all();
+
+                                   queueCv.wait(lock, [&]()
+                                                { return idle != nullptr || cancelled; });
+                                   current = idle;
+                                   idle = nullptr;
+                               }
+
+                               std::lock_guard<std::mutex> lock(queueMutex);
+                               readerDone = true;
+                               queueCv.notify_all(); });
+
+        DirectoryCache directories;
+        std::filesystem::path baseDir(outputDir);
+
+        std::atomic<size_t> failed{0};
+        uint64_t doneFiles = 0;
+
+        // Estágios 2 e 3: decriptação, descompressão e gravação no pool
+        for (;;)
+        {
+            Batch *batch;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCv.wait(lock, [&]()
+                             { return ready != nullptr || readerDone; });
+                if (ready == nullptr || cancelled)
+                {
+                    break;
+                }
+                batch = ready;
+                ready = nullptr;
+                queueCv.notify_all();
+            }
+
+            workers.ParallelFor(batch->count, [&](size_t i)
+                                {
+                                    uint32_t row = rows[batch->first + i];
+                                    uint32_t compressedSize = m_table.compressedSize[row];
+                                    uint32_t uncompressedSize = m_table.uncompressedSize[row];
+                                    uint8_t flags = m_table.flags[row];
+
+                                    if (!batch->readOk[i])
+                                    {
+                                        failed++;
+                                        return;
+                                    }
+
+                                    // Nomes com '..', raiz ou drive escreveriam fora de outputDir
+                                    std::filesystem::path relative;
+                                    if (!GrfNameToPath(m_index.Name(row), relative))
+                                    {
+                                        OutputDebugStringA(("[GRF] ERRO: Caminho fora do destino: " + std::string(m_index.Name(row)) + "\n").c_str());
+                                        failed++;
+                                        return;
+                                    }
+
+                                    // A arena pertence ao lote: cada entrada decripta a própria fatia
+                                    std::span<const uint8_t> raw = batch->views[i];
+                                    if (flags & (GRFFILE_FLAG_MIXCRYPT | GRFFILE_FLAG_DES))
+                                    {
+                                        uint8_t *data = const_cast<uint8_t *>(raw.data());
+                                        GrfDecodeEntry(data, raw.size(), flags, (flags & GRFFILE_FLAG_MIXCRYPT) ? GrfDesCycle(compressedSize) : 0);
+                                    }
+                                    raw = raw.first(compressedSize);
+
+                                    CodecContext &codec = CodecContext::ForThread();
+                                    std::vector<uint8_t> inflated;
+                                    std::span<const uint8_t> content = raw;
+                                    if (compressedSize != uncompressedSize)
+                                    {
+                                        inflated = codec.Buffers().Acquire(uncompressedSize);
+                                        if (!codec.Inflate(raw.data(), raw.size(), uncompressedSize, inflated))
+                                        {
+                                            codec.Buffers().Release(std::move(inflated));
+                                            OutputDebugStringA(("[GRF] ERRO: Falha ao descomprimir: " + std::string(m_index.Name(row)) + "\n").c_str());
+                                            failed++;
+                                            return;
+                                        }
+                                        content = inflated;
+                                    }
+
+                                    std::filesystem::path path = baseDir / relative;
+                                    directories.Ensure(path.parent_path());
+
+                                    File out;
+                                    bool written = out.Create(path.wstring()) && out.WriteAt(0, content.data(), content.size());
+                                    if (!written)
+                                    {
+                                        OutputDebugStringA(("[GRF] ERRO: Falha ao gravar: " + std::string(m_index.Name(row)) + "\n").c_str());
+                                        failed++;
+                                    }
+
+                                    if (!inflated.empty())
+                                    {
+                                        codec.Buffers().Release(std::move(inflated));
+                                    } });
+
+            doneFiles += batch->count;
+
+            bool keepGoing = !progress || progress(doneFiles, rows.size());
+
+            std::lock_guard<std::mutex> lock(queueMutex);
+            idle = batch;
+            if (!keepGoing)
+            {
+                cancelled = true;
+            }
+            queueCv.notify_all();
+        }
+
+        reader.join();
+
+        if (cancelled)
+        {
+            OutputDebugStringA(("[GRF] ExtractAll cancelado após " + std::to_string(doneFiles) + " arquivos\n").c_str());
+            return false;
+        }
+
+        OutputDebugStringA(("[GRF] ExtractAll concluído: " + std::to_string(doneFiles - failed) + " extraídos, " +
+                            std::to_string(failed.load()) + " falhas\n")
+                               .c_str());
+        return failed == 0;
+    }
+
+    bool GrfFile::ExtractBatch(const std::vector<std::string> &names, const GrfBatchSink &sink) const
+    {
+        if (!m_isOpen)
+        {
+            return false;
+        }
+
+        std::vector<std::string_view> keys(names.begin(), names.end());
+        std::vector<uint32_t> found(keys.size());
+        m_index.FindMany(keys.data(), keys.size(), found.data());
+
+        // Pedidos válidos em ordem física; o índice original acompanha cada linha
+        std::vector<size_t> order;
+        order.reserve(names.size());
+        size_t failed = 0;
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            if (found[i] == GrfNameIndex::npos || !(m_table.flags[found[i]] & GRFFILE_FLAG_FILE))
+            {
+                sink(i, names[i], {}, false);
+                failed++;
+                continue;
+            }
+            order.push_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                         { return m_table.offset[found[a]] < m_table.offset[found[b]]; });
+
+        std::vector<uint32_t> rows(order.size());
+        for (size_t k = 0; k < order.size(); k++)
+        {
+            rows[k] = found[order[k]];
+        }
+
+        constexpr uint64_t WINDOW_BYTES = 32 * 1024 * 1024;
+
+        CodecContext &codec = CodecContext::ForThread();
+        std::vector<uint8_t> arena = codec.Buffers().Acquire(0);
+        std::vector<uint8_t> inflated = codec.Buffers().Acquire(0);
+        std::vector<std::span<const uint8_t>> views;
+        std::vector<uint8_t> readOk;
+
+        size_t first = 0;
+        while (first < rows.size())
+        {
+            // Janela: até WINDOW_BYTES de dados comprimidos por vez
+            uint64_t windowSize = 0;
+            size_t end = first;
+            while (end < rows.size())
+            {
+                uint64_t size = m_table.compressedSizeAligned[rows[end]];
+                if (end > first && windowSize + size > WINDOW_BYTES)
+                {
+                    break;
+                }
+                windowSize += size;
+                end++;
+            }
+
+            ReadRows(rows.data() + first, end - first, arena, views, readOk);
+
+            for (size_t k = first; k < end; k++)
+            {
+                size_t index = order[k];
+                uint32_t row = rows[k];
+                uint32_t compressedSize = m_table.compressedSize[row];
+                uint32_t uncompressedSize = m_table.uncompressedSize[row];
+                uint8_t flags = m_table.flags[row];
+
+                if (!readOk[k - first])
+                {
+                    sink(index, names[index], {}, false);
+                    failed++;
+                    continue;
+                }
+
+                std::span<const uint8_t> raw = views[k - first];
+                if (flags & (GRFFILE_FLAG_MIXCRYPT | GRFFILE_FLAG_DES))
+                {
+                    uint8_t *data = const_cast<uint8_t *>(raw.data());
+                    GrfDecodeEntry(data, raw.size(), flags, (flags & GRFFILE_FLAG_MIXCRYPT) ? GrfDesCycle(compressedSize) : 0);
+                }
+                raw = raw.first(compressedSize);
+
+                if (compressedSize == uncompressedSize)
+                {
+                    sink(index, names[index], raw, true);
+                }
+                else if (codec.Inflate(raw.data(), raw.size(), uncompressedSize, inflated))
+                {
+                    sink(index, names[index], inflated, true);
+                }
+                else
+                {
+                    OutputDebugStringA(("[GRF] ERRO: Falha ao descomprimir: " + names[index] + "\n").c_str());
+                    sink(index, names[index], {}, false);
+                    failed++;
+                }
+            }
+
+            first = end;
+        }
+
+        codec.Buffers().Release(std::move(arena));
+        codec.Buffers().Release(std::move(inflated));
+        return failed == 0;
+    }
+
+    bool GrfFile::AddFile(const std::string &filename, const std::vector<uint8_t> &data)
+    {
+        OutputDebugStringA(("[GRF] AddFile: " + filename + " (" + std::to_string(data.size()) + " bytes)\n").c_str());
+
+        if (m_mapped.IsOpen())
+        {
+            OutputDebugStringA("[GRF] ERRO: GRF aberto em modo somente leitura\n");
+            return false;
+        }
+
+        uint64_t hash = 0;
+        if (m_deduplicate)
+        {
+            hash = ContentHash(data.data(), data.size());
+            if (StoreDuplicate(filename, data, hash))
+            {
+                return true;
+            }
+        }
+
+        // Comprime os dados
+        auto compressed = Compress(data);
+        if (compressed.empty() && !data.empty())
+        {
+            OutputDebugStringA("[GRF] ERRO: Falha na compressão\n");
+            return false;
+        }
+
+        if (!StoreCompressed(filename, std::move(compressed), static_cast<uint32_t>(data.size())))
+        {
+            return false;
+        }
+
+        if (m_deduplicate)
+        {
+            RecordContent(filename, hash);
+        }
+        return true;
+    }
+
+    size_t GrfFile::AddFiles(std::vector<GrfAddItem> items, ThreadPool *pool)
+    {
+        OutputDebugStringA(("[GRF] AddFiles: " + std::to_string(items.size()) + " arquivos\n").c_str());
+
+        if (m_mapped.IsOpen())
+        {
+            OutputDebugStringA("[GRF] ERRO: GRF aberto em modo somente leitura\n");
+            return 0;
+        }
+
+        if (!pool)
+        {
+            pool = &ThreadPool::Default();
+        }
+
+        // Comprime em paralelo; os dados originais são liberados assim que comprimidos
+        // (com deduplicação, só depois da comparação com entradas anteriores)
+        std::vector<std::vector<uint8_t>> compressed(items.size());
+        std::vector<uint32_t> sizes(items.size());
+        std::vector<uint64_t> hashes(m_deduplicate ? items.size() : 0);
+        pool->ParallelFor(items.size(), [&](size_t i)
+                          {
+                              sizes[i] = static_cast<uint32_t>(items[i].data.size());
+                              compressed[i] = Compress(items[i].data);
+                              if (m_deduplicate)
+                              {
+                                  hashes[i] = ContentHash(items[i].data.data(), items[i].data.size());
+                              }
+                              else
+                              {
+                                  items[i].data = {};
+                              } });
+
+        // Aplica na ordem de 'items' (mesmo resultado que chamadas sequenciais de AddFile)
+        size_t added = 0;
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            if (m_deduplicate && StoreDuplicate(items[i].filename, items[i].data, hashes[i]))
+            {
+                items[i].data = {};
+                added++;
+                continue;
+            }
+
+            if (compressed[i].empty() && sizes[i] != 0)
+            {
+                OutputDebugStringA(("[GRF] ERRO: Falha na compressão: " + items[i].filename + "\n").c_str());
+                continue;
+            }
+
+            if (StoreCompressed(items[i].filename, std::move(compressed[i]), sizes[i]))
+            {
+                if (m_deduplicate)
+                {
+                    RecordContent(items[i].filename, hashes[i]);
+                }
+                added++;
+            }
+            items[i].data = {};
+        }
+
+        return added;
+    }
+
+    bool GrfFile::AddCompressedFile(const std::string &filename, std::vector<uint8_t> deflateBytes, uint32_t uncompressedSize)
+    {
+        if (m_mapped.IsOpen())
+        {
+            OutputDebugStringA("[GRF] ERRO: GRF aberto em modo somente leitura\n");
+            return false;
+        }
+
+        // GRF guarda streams zlib: deflate puro (ex: THOR) ganha o wrapper, sem recomprimir
+        if (!IsZlibStream(deflateBytes) && !WrapRawDeflate(deflateBytes, uncompressedSize))
+        {
+            OutputDebugStringA(("[GRF] ERRO: Stream comprimido inválido: " + filename + "\n").c_str());
+            return false;
+        }
+
+        return StoreCompressed(filename, std::move(deflateBytes), uncompressedSize);
+    }
+
+    bool GrfFile::ReadCompressed(const std::string &filename, std::vector<uint8_t> &out, uint32_t &uncompressedSize) const
+    {
+        uint32_t row = m_index.Find(filename);
+        if (row == GrfNameIndex::npos || IsDeleted(row) || !(m_table.flags[row] & GRFFILE_FLAG_FILE))
+        {
+            return false;
+        }
+
+        uint32_t compressedSize = m_table.compressedSize[row];
+        uncompressedSize = m_table.uncompressedSize[row];
+
+        // Armazenado sem compressão: não há stream para repassar
+        if (compressedSize == uncompressedSize)
+        {
+            return false;
+        }
+
+        // Entrada ainda não salva: dados comprimidos estão em memória
+        auto state = FindState(row);
+        if (state && !state->cachedData.empty())
+        {
+            out.assign(state->cachedData.begin(), state->cachedData.begin() + compressedSize);
+            return true;
+        }
+
+        out.resize(m_table.compressedSizeAligned[row]);
+        if (!ReadAt(m_table.offset[row] + 46ull, out.data(), out.size()))
+        {
+            return false;
+        }
+
+        DecryptEntry(out, m_table.flags[row], compressedSize);
+        out.resize(compressedSize);
+        return true;
+    }
+
+    bool GrfFile::StoreCompressed(const std::string &filename, std::vector<uint8_t> compressed, uint32_t uncompressedSize)
+    {
+        if (m_writeBehind)
+        {
+            return StoreAtTail(filename, compressed, uncompressedSize);
+        }
+
+        // Verifica se arquivo já existe
+        bool exists = false;
+        uint32_t row = AcquireRow(filename, exists);
+        if (row == GrfNameIndex::npos)
+        {
+            OutputDebugStringA("[GRF] ERRO: Nome de arquivo longo demais\n");
+            return false;
+        }
+
+        // Atualiza entrada na tabela
+        uint32_t compressedSize = static_cast<uint32_t>(compressed.size());
+        m_table.uncompressedSize[row] = uncompressedSize;
+        m_table.compressedSize[row] = compressedSize;
+        m_table.compressedSizeAligned[row] = (compressedSize + 7) & ~7; // Alinha para 8 bytes
+        m_table.flags[row] = GRFFILE_FLAG_FILE;
+
+        // Estado de patching fica no overlay
+        EntryState &state = m_states[row];
+        state.isNew = !exists;
+        state.isModified = exists;
+        state.isDeleted = false;
+        state.cachedData = std::move(compressed);
+
+        // Padding para alinhamento
+        state.cachedData.resize(m_table.compressedSizeAligned[row], 0);
+
+        m_modified = true;
+
+        OutputDebugStringA(("[GRF] Arquivo adicionado: " + filename +
+                            " (compressed: " + std::to_string(compressedSize) +
+                            ", aligned: " + std::to_string(m_table.compressedSizeAligned[row]) + ")\n")
+                               .c_str());
+        return true;
+    }
+
+    bool GrfFile::StoreAtTail(const std::string &filename, const std::vector<uint8_t> &compressed, uint32_t uncompressedSize)
+    {
+        // Região nova no fim da área de dados: a tabela gravada não a referencia
+        uint32_t compressedSize = static_cast<uint32_t>(compressed.size());
+        uint32_t compressedSizeAligned = (compressedSize + 7) & ~7;
+        uint64_t offset = m_space.AllocateAtEnd(compressedSizeAligned);
+        if (!AppendToTail(offset, compressed.data(), compressedSize, compressedSizeAligned))
+        {
+            m_space.Free(offset, compressedSizeAligned);
+            OutputDebugStringA(("[GRF] ERRO: Falha ao gravar no fim do arquivo: " + filename + "\n").c_str());
+            return false;
+        }
+
+        bool exists = false;
+        uint32_t row = AcquireRow(filename, exists);
+        if (row == GrfNameIndex::npos)
+        {
+            // Os bytes ainda na fila sairiam num FlushTail depois de a região ser realocada
+            if (!m_tailBuffer.empty() && m_tailOffset + m_tailBuffer.size() == offset + compressedSizeAligned)
+            {
+                m_tailBuffer.resize(m_tailBuffer.size() - compressedSizeAligned);
+            }
+            m_space.Free(offset, compressedSizeAligned);
+            OutputDebugStringA("[GRF] ERRO: Nome de arquivo longo demais\n");
+            return false;
+        }
+
+        m_table.uncompressedSize[row] = uncompressedSize;
+        m_table.compressedSize[row] = compressedSize;
+        m_table.compressedSizeAligned[row] = compressedSizeAligned;
+        m_table.flags[row] = GRFFILE_FLAG_FILE;
+        m_table.offset[row] = offset;
+
+        // Dados já têm lugar no arquivo (ou no buffer): a linha não tem estado pendente
+        m_states.erase(row);
+        m_fileSize = std::max(m_fileSize, 46 + m_space.End());
+        m_modified = true;
+        return true;
+    }
+
+    bool GrfFile::AppendToTail(uint64_t offset, const uint8_t *data, size_t size, size_t alignedSize)
+    {
+        // O buffer só guarda um trecho contíguo: outra posição grava o que estava pendente
+        if (!m_tailBuffer.empty() && offset != m_tailOffset + m_tailBuffer.size() && !FlushTail())
+        {
+            return false;
+        }
+        if (m_tailBuffer.size() + alignedSize > TAIL_BUFFER_SIZE && !FlushTail())
+        {
+            return false;
+        }
+
+        static const uint8_t padding[8] = {};
+        if (alignedSize > TAIL_BUFFER_SIZE)
+        {
+            // Maior que o buffer: vai direto para o arquivo
+            return m_file.WriteAt(46 + offset, data, size) &&
+                   m_file.WriteAt(46 + offset + size, padding, alignedSize - size);
+        }
+
+        if (m_tailBuffer.empty())
+        {
+            m_tailOffset = offset;
+            m_tailBuffer.reserve(TAIL_BUFFER_SIZE);
+        }
+        m_tailBuffer.insert(m_tailBuffer.end(), data, data + size);
+        m_tailBuffer.insert(m_tailBuffer.end(), padding, padding + (alignedSize - size));
+        return true;
+    }
+
+    bool GrfFile::FlushTail()
+    {
+        if (m_tailBuffer.empty())
+        {
+            return true;
+        }
+
+        if (!m_file.WriteAt(46 + m_tailOffset, m_tailBuffer.data(), m_tailBuffer.size()))
+        {
+            OutputDebugStringA("[GRF] ERRO: Falha ao gravar buffer de write-behind\n");
+            return false;
+        }
+
+        m_tailBuffer.clear();
+        return true;
+    }
+
+    bool GrfFile::StoreDuplicate(const std::string &filename, const std::vector<uint8_t> &data, uint64_t hash)
+    {
+        auto it = m_contentRows.find(hash);
+        if (it == m_contentRows.end())
+        {
+            return false;
+        }
+
+        uint32_t source = it->second;
+        if (IsDeleted(source) || m_table.uncompressedSize[source] != data.size())
+        {
+            return false;
+        }
+
+        // O hash só aponta o candidato: confere o conteúdo
+        CodecContext &codec = CodecContext::ForThread();
+        std::vector<uint8_t> existing = codec.Buffers().Acquire(0);
+        bool same = ExtractInto(std::string(m_index.Name(source)), existing) && existing.size() == data.size() &&
+                    (data.empty() || memcmp(existing.data(), data.data(), data.size()) == 0);
+        codec.Buffers().Release(std::move(existing));
+        if (!same)
+        {
+            return false;
+        }
+
+        // Mesmo nome e mesmo conteúdo: nada muda
+        uint32_t current = m_index.Find(filename);
+        if (current == source)
+        {
+            return true;
+        }
+
+        // Dados ainda em memória ganham lugar no arquivo antes de serem compartilhados
+        auto state = FindState(source);
+        if (state && !state->cachedData.empty() && !WritePending(source))
+        {
+            return false;
+        }
+
+        bool exists = false;
+        uint32_t row = AcquireRow(filename, exists);
+        if (row == GrfNameIndex::npos)
+        {
+            OutputDebugStringA("[GRF] ERRO: Nome de arquivo longo demais\n");
+            return false;
+        }
+
+        CopyRowColumns(*this, source, row, m_table.offset[source]);
+        AddBlobRef(m_table.offset[source]);
+
+        // Linha aponta para dados já no arquivo: sem estado pendente
+        m_states.erase(row);
+        m_modified = true;
+        m_dedupSavedBytes += m_table.compressedSizeAligned[row];
+        m_dedupCount++;
+
+        OutputDebugStringA(("[GRF] Arquivo duplicado: " + filename + " -> " + std::string(m_index.Name(source)) + "\n").c_str());
+        return true;
+    }
+
+    bool GrfFile::WritePending(uint32_t row)
+    {
+        EntryState &state = m_states[row];
+        uint64_t size = state.cachedData.size();
+        uint64_t offset = m_space.Allocate(size);
+        if (!m_file.WriteAt(46 + offset, state.cachedData.data(), state.cachedData.size()))
+        {
+            m_space.Free(offset, size);
+            OutputDebugStringA(("[GRF] ERRO: Falha ao gravar entrada: " + std::string(m_index.Name(row)) + "\n").c_str());
+            return false;
+        }
+
+        // Região fora da tabela gravada: a linha passa a não ter estado pendente
+        m_table.offset[row] = offset;
+        m_states.erase(row);
+        m_fileSize = std::max(m_fileSize, 46 + m_space.End());
+        return true;
+    }
+
+    void GrfFile::RecordContent(const std::string &filename, uint64_t hash)
+    {
+        uint32_t row = m_index.Find(filename);
+        if (row != GrfNameIndex::npos)
+        {
+            m_contentRows[hash] = row;
+        }
+    }
+
+    bool GrfFile::AddFile(const std::string &filename, const std::wstring &sourcePath)
+    {
+        if (m_mapped.IsOpen() || !m_file.IsOpen())
+        {
+            OutputDebugStringA("[GRF] ERRO: GRF aberto em modo somente leitura\n");
+            return false;
+        }
+
+        File source;
+        if (!source.Open(sourcePath))
+        {
+            return false;
+        }
+
+        uint64_t sourceSize = source.Size();
+        uint64_t readPos = 0;
+        auto read = [&](uint8_t *dst, size_t capacity, size_t &count)
+        {
+            count = static_cast<size_t>(std::min<uint64_t>(capacity, sourceSize - readPos));
+            if (!source.ReadAt(readPos, dst, count))
+            {
+                return false;
+            }
+            readPos += count;
+            return true;
+        };
+
+        return AddFile(filename, read, sourceSize);
+    }
+
+    bool GrfFile::AddFile(const std::string &filename, const CodecContext::StreamReader &read, uint64_t size)
+    {
+        /**
+         * Adição em stream
+         *
+         * Os dados são lidos e comprimidos em blocos de 1 MB, e cada bloco comprimido
+         * é gravado direto após o fim da área de dados (região que a tabela gravada não
+         * referencia). No final o espaço é alocado com o tamanho real e a entrada aponta
+         * para os dados, como no Merge; a tabela é gravada no Save(). A memória usada não
+         * depende do tamanho do arquivo.
+         */
+        if (m_mapped.IsOpen() || !m_file.IsOpen())
+        {
+            OutputDebugStringA("[GRF] ERRO: GRF aberto em modo somente leitura\n");
+            return false;
+        }
+
+        if (size > UINT32_MAX)
+        {
+            OutputDebugStringA(("[GRF] ERRO: Arquivo grande demais para uma entrada GRF: " + filename + "\n").c_str());
+            return false;
+        }
+
+        OutputDebugStringA(("[GRF] AddFile (stream): " + filename + " (" + std::to_string(size) + " bytes)\n").c_str());
+
+        uint64_t fileEnd = m_file.Size();
+        uint64_t start = StreamStart();
+        uint64_t written = 0;
+        auto write = [&](const uint8_t *data, size_t count)
+        {
+            if (!m_file.WriteAt(46 + start + written, data, count))
+            {
+                return false;
+            }
+            written += count;
+            return true;
+        };
+
+        uint64_t totalIn = 0;
+        uint64_t totalOut = 0;
+        if (!CodecContext::ForThread().DeflateStream(read, write, totalIn, totalOut) ||
+            totalIn != size || totalOut > UINT32_MAX)
+        {
+            OutputDebugStringA(("[GRF] ERRO: Falha na compressão em stream: " + filename + "\n").c_str());
+            DiscardStreamed(fileEnd, 46 + start + written);
+            return false;
+        }
+
+        if (!StoreStreamed(filename, start, static_cast<uint32_t>(totalOut), static_cast<uint32_t>(size)))
+        {
+            DiscardStreamed(fileEnd, 46 + start + ((totalOut + 7) & ~7ull));
+            return false;
+        }
+        return true;
+    }
+
+    bool GrfFile::AddCompressedFile(const std::string &filename, const CodecContext::StreamReader &read, uint32_t uncompressedSize)
+    {
+        // O deflate puro é copiado em blocos para o fim da área de dados, entre o header e o
+        // trailer zlib; a cópia passa pelo inflate só para calcular o Adler-32 e validar o tamanho
+        if (m_mapped.IsOpen() || !m_file.IsOpen())
+        {
+            OutputDebugStringA("[GRF] ERRO: GRF aberto em modo somente leitura\n");
+            return false;
+        }
+
+        static const uint8_t ZLIB_HEADER[2] = {0x78, 0x9C};
+        uint64_t fileEnd = m_file.Size();
+        uint64_t start = StreamStart();
+        uint64_t dataStart = 46 + start + sizeof(ZLIB_HEADER);
+        if (!m_file.WriteAt(46 + start, ZLIB_HEADER, sizeof(ZLIB_HEADER)))
+        {
+            DiscardStreamed(fileEnd, dataStart);
+            return false;
+        }
+
+        // Cada bloco só é gravado quando o inflate pede o próximo (o anterior foi todo
+        // consumido); do último vão só os bytes que o stream usou
+        CodecContext &codec = CodecContext::ForThread();
+        std::vector<uint8_t> pending = codec.Buffers().Acquire(CodecContext::STREAM_CHUNK_SIZE);
+        size_t pendingCount = 0;
+        uint64_t copied = 0;
+        auto copy = [&](uint8_t *dst, size_t capacity, size_t &count)
+        {
+            if (pendingCount > 0 && !m_file.WriteAt(dataStart + copied, pending.data(), pendingCount))
+            {
+                return false;
+            }
+            copied += pendingCount;
+            pendingCount = 0;
+
+            if (!read(dst, capacity, count) || count > pending.size())
+            {
+                return false;
+            }
+            memcpy(pending.data(), dst, count);
+            pendingCount = count;
+            return true;
+        };
+
+        uLong adler = adler32(0L, Z_NULL, 0);
+        auto checksum = [&](const uint8_t *data, size_t count)
+        {
+            adler = adler32(adler, data, static_cast<uInt>(count));
+            return true;
+        };
+
+        uint64_t totalIn = 0;
+        uint64_t totalOut = 0;
+        bool ok = codec.InflateStream(copy, checksum, true, totalIn, totalOut) &&
+                  totalOut == uncompressedSize && sizeof(ZLIB_HEADER) + totalIn + 4 <= UINT32_MAX &&
+                  totalIn >= copied && totalIn - copied <= pendingCount;
+        ok = ok && (totalIn == copied || m_file.WriteAt(dataStart + copied, pending.data(), static_cast<size_t>(totalIn - copied)));
+        codec.Buffers().Release(std::move(pending));
+        if (!ok)
+        {
+            OutputDebugStringA(("[GRF] ERRO: Stream comprimido inválido: " + filename + "\n").c_str());
+            DiscardStreamed(fileEnd, dataStart + copied);
+            return false;
+        }
+
+        // Trailer logo após o fim do stream
+        const uint8_t trailer[4] = {static_cast<uint8_t>(adler >> 24), static_cast<uint8_t>(adler >> 16),
+                                    static_cast<uint8_t>(adler >> 8), static_cast<uint8_t>(adler)};
+        uint64_t compressedSize = sizeof(ZLIB_HEADER) + totalIn + sizeof(trailer);
+        if (!m_file.WriteAt(dataStart + totalIn, trailer, sizeof(trailer)) ||
+            !StoreStreamed(filename, start, static_cast<uint32_t>(compressedSize), uncompressedSize))
+        {
+            DiscardStreamed(fileEnd, 46 + start + ((compressedSize + 7) & ~7ull));
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t GrfFile::StreamStart() const
+    {
+        constexpr uint64_t ALIGNMENT = GrfSpaceAllocator::ALIGNMENT;
+        return (m_space.End() + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    void GrfFile::DiscardStreamed(uint64_t fileEnd, uint64_t writtenEnd)
+    {
+        // Stream abortado: corta o que foi gravado além do fim anterior do arquivo
+        if (writtenEnd > fileEnd && !m_file.Resize(fileEnd))
+        {
+            OutputDebugStringA("[GRF] AVISO: Falha ao descartar dados do stream\n");
+        }
+    }
+
+    bool GrfFile::StoreStreamed(const std::string &filename, uint64_t start, uint32_t compressedSize, uint32_t uncompressedSize)
+    {
+        // Padding para alinhamento
+        uint32_t compressedSizeAligned = (compressedSize + 7) & ~7;
+        static const uint8_t padding[8] = {};
+        if (!m_file.WriteAt(46 + start + compressedSize, padding, compressedSizeAligned - compressedSize))
+        {
+            return false;
+        }
+
+        // Nada foi alocado durante o stream: o fim da área de dados é o mesmo.
+        // A linha só é tocada depois: AcquireRow libera os dados antigos da entrada
+        uint64_t offset = m_space.AllocateAtEnd(compressedSizeAligned);
+        if (offset != start)
+        {
+            m_space.Free(offset, compressedSizeAligned);
+            return false;
+        }
+
+        bool exists = false;
+        uint32_t row = AcquireRow(filename, exists);
+        if (row == GrfNameIndex::npos)
+        {
+            m_space.Free(offset, compressedSizeAligned);
+            OutputDebugStringA("[GRF] ERRO: Nome de arquivo longo demais\n");
+            return false;
+        }
+
+        m_table.uncompressedSize[row] = uncompressedSize;
+        m_table.compressedSize[row] = compressedSize;
+        m_table.compressedSizeAligned[row] = compressedSizeAligned;
+        m_table.flags[row] = GRFFILE_FLAG_FILE;
+        m_table.offset[row] = offset;
+
+        // Dados já estão no arquivo: a linha não tem estado pendente
+        m_states.erase(row);
+        m_fileSize = std::max(m_fileSize, 46 + m_space.End());
+        m_modified = true;
+
+        OutputDebugStringA(("[GRF] Arquivo adicionado: " + filename +
+                            " (compressed: " + std::to_string(compressedSize) +
+                            ", aligned: " + std::to_string(compressedSizeAligned) + ")\n")
+                               .c_str());
+        return true;
+    }
+
+    bool GrfFile::RemoveFile(const std::string &filename)
+    {
+        uint32_t row = m_index.Find(filename);
+        if (row == GrfNameIndex::npos || m_mapped.IsOpen())
+        {
+            return false;
+        }
+
+        // Marca como deletado em vez de remover
+        ReleaseCommittedData(row);
+        m_states[row].isDeleted = true;
+        m_modified = true;
+        return true;
+    }
+
+    bool GrfFile::Save()
+    {
+        OutputDebugStringA("[GRF] Iniciando Save (QuickMerge)...\n");
+
+        if (!m_isOpen || !m_file.IsOpen())
+        {
+            OutputDebugStringA("[GRF] ERRO: Arquivo não está aberto\n");
+            return false;
+        }
+
+        if (!m_modified)
+        {
+            OutputDebugStringA("[GRF] Nenhuma modificação pendente\n");
+            return true;
+        }
+
+        // Write-behind: só resta gravar o que ainda está no buffer
+        if (!FlushTail())
+        {
+            return false;
+        }
+
+        // QuickMerge: Escreve apenas arquivos novos/modificados ao final
+        if (!WriteFileData())
+        {
+            OutputDebugStringA("[GRF] ERRO: Falha ao escrever dados\n");
+            return false;
+        }
+
+        if (!CommitTable(false))
+        {
+            return false;
+        }
+
+        m_modified = false;
+        if (m_dedupCount > 0)
+        {
+            OutputDebugStringA(("[GRF] Deduplicação: " + std::to_string(m_dedupCount) + " entradas, " +
+                                std::to_string(m_dedupSavedBytes) + " bytes economizados\n")
+                                   .c_str());
+        }
+        OutputDebugStringA(("[GRF] Save concluído com sucesso. Arquivos: " + std::to_string(m_header.fileCount) + "\n").c_str());
+        return true;
+    }
+
+    void GrfFile::Discard()
+    {
+        if (m_isOpen && m_modified)
+        {
+            OutputDebugStringA("[GRF] Descartando alterações não salvas\n");
+
+            // Dados já gravados em buracos não são referenciados pela tabela gravada;
+            // os gravados além do fim anterior do arquivo são cortados
+            m_tailBuffer = {};
+            if (m_file.IsOpen() && m_file.Size() > m_committedFileSize && !m_file.Resize(m_committedFileSize))
+            {
+                OutputDebugStringA("[GRF] AVISO: Falha ao cortar dados descartados\n");
+            }
+
+            // A tabela em memória não corresponde mais à gravada: não vira .idx
+            m_modified = false;
+            m_indexDirty = false;
+        }
+
+        Close();
+    }
+
+    bool GrfFile::CommitTable(bool lowestTable)
+    {
+        // Atualiza contagem de arquivos
+        uint32_t fileCount = static_cast<uint32_t>(m_table.Size());
+        for (const auto &[row, state] : m_states)
+        {
+            if (state.isDeleted)
+            {
+                fileCount--;
+            }
+        }
+        m_header.fileCount = fileCount;
+
+        // A tabela é sempre gravada no formato 0x200
+        if ((static_cast<uint32_t>(m_header.version) & 0xFF00) == 0x100)
+        {
+            m_header.version = GrfVersion::V0x200;
+        }
+
+        // Escreve tabela de arquivos
+        uint64_t tableRegionSize = 0;
+        if (!WriteFileTable(tableRegionSize, lowestTable))
+        {
+            OutputDebugStringA("[GRF] ERRO: Falha ao escrever tabela de arquivos\n");
+            return false;
+        }
+
+        // Escreve header atualizado (a partir daqui a nova tabela é a válida)
+        if (!WriteHeader())
+        {
+            OutputDebugStringA("[GRF] ERRO: Falha ao escrever header\n");
+            return false;
+        }
+
+        // Tabela nova em uso: espaço liberado nesta sessão passa a ser reutilizável
+        CommitFreeSpace(m_header.fileTableOffset, tableRegionSize);
+        m_indexDirty = m_useIndexFile;
+        m_fileSize = std::max(m_fileSize, 46 + m_space.End());
+        m_committedFileSize = std::max(m_committedFileSize, m_fileSize);
+
+        GrfSpaceStats space = GetSpaceStats();
+        OutputDebugStringA(("[GRF] Espaço: " + std::to_string(space.liveBytes) + " bytes vivos, " +
+                            std::to_string(space.DeadBytes()) + " bytes mortos\n")
+                               .c_str());
+        return true;
+    }
+
+    bool GrfFile::CompactStep(uint64_t byteBudget, bool &finished)
+    {
+        /**
+         * Compactação incremental
+         *
+         * Cada passo:
+         * 1. Percorre as entradas do fim para o início do arquivo
+         * 2. Copia os bytes comprimidos (sem recomprimir) para o buraco de menor
+         *    offset abaixo da entrada, até consumir 'byteBudget'
+         * 3. Grava a nova tabela e o header
+         *
+         * Os destinos são buracos que a tabela gravada não referencia, e as regiões
+         * de origem só viram buracos depois do header gravado. Uma interrupção em
+         * qualquer ponto deixa a tabela anterior válida; o progresso é derivado da
+         * própria tabela, então basta chamar de novo (mesmo após reabrir o arquivo).
+         */
+        finished = false;
+
+        if (!m_isOpen || !m_file.IsOpen())
+        {
+            OutputDebugStringA("[GRF] ERRO: Arquivo não está aberto para escrita\n");
+            return false;
+        }
+
+        // Alterações pendentes precisam estar gravadas antes de mover dados
+        if (m_modified && !Save())
+        {
+            return false;
+        }
+
+        // Entradas gravadas, da mais próxima do fim para a mais próxima do início
+        std::vector<uint32_t> rows;
+        rows.reserve(m_table.Size());
+        for (uint32_t row = 0; row < m_table.Size(); row++)
+        {
+            if (IsCommitted(row) && m_table.compressedSizeAligned[row] > 0)
+            {
+                rows.push_back(row);
+            }
+        }
+        std::sort(rows.begin(), rows.end(), [this](uint32_t a, uint32_t b)
+                  { return m_table.offset[a] > m_table.offset[b]; });
+
+        std::vector<uint8_t> buffer;
+        uint64_t movedBytes = 0;
+        int movedCount = 0;
+
+        for (size_t i = 0; i < rows.size();)
+        {
+            // Linhas com o mesmo offset compartilham os dados e se movem juntas
+            uint32_t row = rows[i];
+            uint64_t source = m_table.offset[row];
+            uint64_t size = m_table.compressedSizeAligned[row];
+            size_t groupEnd = i + 1;
+            while (groupEnd < rows.size() && m_table.offset[rows[groupEnd]] == source)
+            {
+                size = std::max<uint64_t>(size, m_table.compressedSizeAligned[rows[groupEnd]]);
+                groupEnd++;
+            }
+            size_t groupStart = i;
+            i = groupEnd;
+
+            if (movedBytes > 0 && byteBudget > 0 && movedBytes + size > byteBudget)
+            {
+                break;
+            }
+            if (m_space.HoleCount() == 0)
+            {
+                break;
+            }
 
-            // Limpar cache (dados já foram escritos)
-            entry.cachedData.clear();
-            entry.cachedData.shrink_to_fit();
+            uint64_t target = m_space.AllocateLowest(size, source);
+            if (target == GrfSpaceAllocator::npos)
+            {
+                continue;
+            }
+
+            buffer.resize(size);
+            if (!ReadAt(46 + source, buffer.data(), buffer.size()))
+            {
+                OutputDebugStringA(("[GRF] ERRO: Falha ao ler para compactação: " + std::string(m_index.Name(row)) + "\n").c_str());
+                return false;
+            }
+
+            if (!m_file.WriteAt(46 + target, buffer.data(), buffer.size()))
+            {
+                OutputDebugStringA(("[GRF] ERRO: Falha ao escrever para compactação: " + std::string(m_index.Name(row)) + "\n").c_str());
+                return false;
+            }
+
+            for (size_t j = groupStart; j < groupEnd; j++)
+            {
+                m_table.offset[rows[j]] = target;
+            }
+            auto shared = m_blobRefs.find(source);
+            if (shared != m_blobRefs.end())
+            {
+                uint32_t refs = shared->second;
+                m_blobRefs.erase(shared);
+                m_blobRefs[target] = refs;
+            }
+            m_released.emplace_back(source, size);
+            movedBytes += size;
+            movedCount += static_cast<int>(groupEnd - groupStart);
+        }
+
+        if (movedCount > 0)
+        {
+            if (!CommitTable(true))
+            {
+                return false;
+            }
+
+            OutputDebugStringA(("[GRF] Compactação: " + std::to_string(movedCount) + " entradas movidas (" +
+                                std::to_string(movedBytes) + " bytes)\n")
+                                   .c_str());
+            return true;
+        }
+
+        // Nada mais desce. A tabela não mudou (mesmo tamanho): só é regravada se couber
+        // num buraco abaixo da posição atual; caso contrário nada é gravado além do truncamento.
+        if (m_space.FindLowest(m_tableRegionSize, m_tableRegionOffset) != GrfSpaceAllocator::npos &&
+            !CommitTable(true))
+        {
+            return false;
+        }
+
+        if (!TruncateToDataEnd())
+        {
+            return false;
         }
 
-        // Atualizar offset da tabela de arquivos
-        m_header.fileTableOffset = static_cast<uint32_t>(writeOffset);
+        finished = true;
+        GrfSpaceStats space = GetSpaceStats();
+        OutputDebugStringA(("[GRF] Compactação concluída: " + std::to_string(space.fileSize) + " bytes, " +
+                            std::to_string(space.DeadBytes()) + " bytes mortos restantes\n")
+                               .c_str());
+        return true;
+    }
+
+    bool GrfFile::TruncateToDataEnd()
+    {
+        uint64_t newSize = 46 + m_space.End();
+        if (m_fileSize <= newSize)
+        {
+            return true;
+        }
+
+        // Nada além de End() é referenciado pela tabela gravada
+        if (!m_file.Resize(newSize))
+        {
+            OutputDebugStringA("[GRF] AVISO: Falha ao truncar arquivo\n");
+            return true;
+        }
+
+        OutputDebugStringA(("[GRF] Arquivo truncado: " + std::to_string(m_fileSize) + " -> " + std::to_string(newSize) + " bytes\n").c_str());
+        m_fileSize = newSize;
+        m_committedFileSize = newSize;
+        return true;
+    }
+
+    bool GrfFile::WriteFileData()
+    {
+        /**
+         * QuickMerge Implementation
+         *
+         * Estratégia:
+         * 1. Coletar entradas novas/modificadas
+         * 2. Posicionar cada uma no menor buraco onde cabe (best-fit), ou ao final
+         * 3. Atualizar offsets das entradas
+         *
+         * Buracos só contêm bytes que a tabela gravada não referencia, então
+         * uma interrupção antes do header ser gravado não corrompe o GRF.
+         */
+
+        // Passo 1: Coletar novos/modificados, maiores primeiro (melhor aproveitamento dos buracos)
+        std::vector<uint32_t> pendingRows;
+        for (const auto &[row, state] : m_states)
+        {
+            if (!state.isDeleted && (state.isNew || state.isModified))
+            {
+                pendingRows.push_back(row);
+            }
+        }
+        std::sort(pendingRows.begin(), pendingRows.end(), [this](uint32_t a, uint32_t b)
+                  {
+                      uint32_t sizeA = m_table.compressedSizeAligned[a];
+                      uint32_t sizeB = m_table.compressedSizeAligned[b];
+                      return sizeA != sizeB ? sizeA > sizeB : a < b;
+                  });
+
+        OutputDebugStringA(("[GRF] Fim da área de dados: " + std::to_string(m_space.End()) +
+                            ", buracos: " + std::to_string(m_space.FreeBytes()) + " bytes\n")
+                               .c_str());
+
+        // Passo 2: Escrever
+        int writtenCount = 0;
+        int reusedCount = 0;
+
+        for (uint32_t row : pendingRows)
+        {
+            EntryState &state = m_states[row];
+            std::string name(m_index.Name(row));
+
+            if (state.cachedData.empty())
+            {
+                OutputDebugStringA(("[GRF] AVISO: Dados vazios para: " + name + "\n").c_str());
+                continue;
+            }
+
+            uint64_t endBefore = m_space.End();
+            uint64_t writeOffset = m_space.Allocate(state.cachedData.size());
+            bool reused = writeOffset < endBefore;
+
+            // Escrever na posição (offset é relativo ao fim do header, que tem 46 bytes)
+            if (!m_file.WriteAt(46 + writeOffset, state.cachedData.data(), state.cachedData.size()))
+            {
+                OutputDebugStringA(("[GRF] ERRO: Falha ao escrever: " + name + "\n").c_str());
+                return false;
+            }
+
+            // Atualizar offset da entrada
+            m_table.offset[row] = writeOffset;
 
-        OutputDebugStringA(("[GRF] Escritos " + std::to_string(writtenCount) + " arquivos. Table offset: " +
-                            std::to_string(m_header.fileTableOffset) + "\n")
+            OutputDebugStringA(("[GRF] Escrito: " + name + " @ offset " + std::to_string(writeOffset) +
+                                (reused ? " (buraco reutilizado)\n" : "\n"))
+                                   .c_str());
+
+            writtenCount++;
+            if (reused)
+            {
+                reusedCount++;
+            }
+
+            // Dados já foram escritos: a entrada sai do overlay
+            m_states.erase(row);
+        }
+
+        OutputDebugStringA(("[GRF] Escritos " + std::to_string(writtenCount) + " arquivos (" +
+                            std::to_string(reusedCount) + " em buracos)\n")
                                .c_str());
 
         return true;
@@ -500,73 +2183,115 @@ namespace autopatch
 
     bool GrfFile::WriteHeader()
     {
-        m_file.seekp(0);
+        uint8_t raw[46];
 
         // Signature (16 bytes)
-        m_file.write(m_header.signature, 16);
+        memcpy(raw, m_header.signature, 16);
 
         // Encryption key (14 bytes)
-        m_file.write(reinterpret_cast<const char *>(m_header.encryptionKey), 14);
+        memcpy(raw + 16, m_header.encryptionKey, 14);
 
-        // File table offset (4 bytes)
-        m_file.write(reinterpret_cast<const char *>(&m_header.fileTableOffset), 4);
+        if (m_header.version == GrfVersion::V0x300)
+        {
+            // File table offset (8 bytes, sem seed)
+            memcpy(raw + 30, &m_header.fileTableOffset, 8);
+        }
+        else
+        {
+            // File table offset (4 bytes)
+            uint32_t tableOffset = static_cast<uint32_t>(m_header.fileTableOffset);
+            memcpy(raw + 30, &tableOffset, 4);
 
-        // Seed (4 bytes)
-        m_file.write(reinterpret_cast<const char *>(&m_header.seed), 4);
+            // Seed (4 bytes)
+            memcpy(raw + 34, &m_header.seed, 4);
+        }
 
         // File count (stored as count + seed + 7)
         uint32_t storedCount = m_header.fileCount + m_header.seed + 7;
-        m_file.write(reinterpret_cast<const char *>(&storedCount), 4);
+        memcpy(raw + 38, &storedCount, 4);
 
         // Version (4 bytes)
         uint32_t version = static_cast<uint32_t>(m_header.version);
-        m_file.write(reinterpret_cast<const char *>(&version), 4);
+        memcpy(raw + 42, &version, 4);
+
+        return m_file.WriteAt(0, raw, sizeof(raw));
+    }
+
+    bool GrfFile::NeedsLargeOffsets() const
+    {
+        // A tabela vai para um buraco ou para o fim atual; ambos ficam abaixo de End()
+        if (m_space.End() > UINT32_MAX)
+        {
+            return true;
+        }
 
-        return m_file.good();
+        for (uint32_t row = 0; row < m_table.Size(); row++)
+        {
+            if (!IsDeleted(row) && m_table.offset[row] > UINT32_MAX)
+            {
+                return true;
+            }
+        }
+        return false;
     }
 
-    bool GrfFile::WriteFileTable()
+    bool GrfFile::WriteFileTable(uint64_t &tableRegionSize, bool lowest)
     {
+        // Offsets de 32 bits não alcançam além de 4 GB: passa para 0x300 antes de gravar
+        if (m_header.version != GrfVersion::V0x300 && NeedsLargeOffsets())
+        {
+            OutputDebugStringA("[GRF] Arquivo ultrapassa 4 GB, convertendo para versão 0x300\n");
+            m_header.version = GrfVersion::V0x300;
+            m_header.seed = 0;
+        }
+        size_t offsetSize = m_header.version == GrfVersion::V0x300 ? 8 : 4;
+
         // Constrói tabela de arquivos
         std::vector<uint8_t> tableData;
 
-        for (const auto &[name, entry] : m_entries)
+        for (uint32_t row = 0; row < m_table.Size(); row++)
         {
-            if (entry.isDeleted)
+            if (IsDeleted(row))
             {
                 continue;
             }
 
+            std::string_view filename = m_index.Name(row);
+            uint32_t compressedSize = m_table.compressedSize[row];
+            uint32_t compressedSizeAligned = m_table.compressedSizeAligned[row];
+            uint32_t uncompressedSize = m_table.uncompressedSize[row];
+            uint64_t offset = m_table.offset[row];
+
             // Nome do arquivo + null terminator
-            tableData.insert(tableData.end(), entry.filename.begin(), entry.filename.end());
+            tableData.insert(tableData.end(), filename.begin(), filename.end());
             tableData.push_back(0);
 
             // Compressed size (4 bytes)
-            tableData.push_back(entry.compressedSize & 0xFF);
-            tableData.push_back((entry.compressedSize >> 8) & 0xFF);
-            tableData.push_back((entry.compressedSize >> 16) & 0xFF);
-            tableData.push_back((entry.compressedSize >> 24) & 0xFF);
+            tableData.push_back(compressedSize & 0xFF);
+            tableData.push_back((compressedSize >> 8) & 0xFF);
+            tableData.push_back((compressedSize >> 16) & 0xFF);
+            tableData.push_back((compressedSize >> 24) & 0xFF);
 
             // Compressed size aligned (4 bytes)
-            tableData.push_back(entry.compressedSizeAligned & 0xFF);
-            tableData.push_back((entry.compressedSizeAligned >> 8) & 0xFF);
-            tableData.push_back((entry.compressedSizeAligned >> 16) & 0xFF);
-            tableData.push_back((entry.compressedSizeAligned >> 24) & 0xFF);
+            tableData.push_back(compressedSizeAligned & 0xFF);
+            tableData.push_back((compressedSizeAligned >> 8) & 0xFF);
+            tableData.push_back((compressedSizeAligned >> 16) & 0xFF);
+            tableData.push_back((compressedSizeAligned >> 24) & 0xFF);
 
             // Uncompressed size (4 bytes)
-            tableData.push_back(entry.uncompressedSize & 0xFF);
-            tableData.push_back((entry.uncompressedSize >> 8) & 0xFF);
-            tableData.push_back((entry.uncompressedSize >> 16) & 0xFF);
-            tableData.push_back((entry.uncompressedSize >> 24) & 0xFF);
+            tableData.push_back(uncompressedSize & 0xFF);
+            tableData.push_back((uncompressedSize >> 8) & 0xFF);
+            tableData.push_back((uncompressedSize >> 16) & 0xFF);
+            tableData.push_back((uncompressedSize >> 24) & 0xFF);
 
             // Flags (1 byte)
-            tableData.push_back(entry.flags);
+            tableData.push_back(m_table.flags[row]);
 
-            // Offset (4 bytes)
-            tableData.push_back(entry.offset & 0xFF);
-            tableData.push_back((entry.offset >> 8) & 0xFF);
-            tableData.push_back((entry.offset >> 16) & 0xFF);
-            tableData.push_back((entry.offset >> 24) & 0xFF);
+            // Offset (4 bytes, 8 em 0x300)
+            for (size_t i = 0; i < offsetSize; i++)
+            {
+                tableData.push_back((offset >> (8 * i)) & 0xFF);
+            }
         }
 
         OutputDebugStringA(("[GRF] Tabela de arquivos: " + std::to_string(tableData.size()) + " bytes não comprimidos\n").c_str());
@@ -576,73 +2301,429 @@ namespace autopatch
 
         OutputDebugStringA(("[GRF] Tabela comprimida: " + std::to_string(compressedTable.size()) + " bytes\n").c_str());
 
-        // Posiciona e escreve
-        m_file.seekp(static_cast<std::streamoff>(46 + m_header.fileTableOffset));
+        // Posiciona e escreve (a tabela anterior continua reservada até o commit)
+        tableRegionSize = 8ull + compressedTable.size();
+        uint64_t tableOffset = lowest ? m_space.AllocateLowest(tableRegionSize) : GrfSpaceAllocator::npos;
+        if (tableOffset == GrfSpaceAllocator::npos)
+        {
+            tableOffset = m_space.Allocate(tableRegionSize);
+        }
+        m_header.fileTableOffset = tableOffset;
 
-        uint32_t tableSizeCompressed = static_cast<uint32_t>(compressedTable.size());
-        uint32_t tableSize = static_cast<uint32_t>(tableData.size());
+        OutputDebugStringA(("[GRF] Table offset: " + std::to_string(tableOffset) + "\n").c_str());
 
-        m_file.write(reinterpret_cast<const char *>(&tableSizeCompressed), 4);
-        m_file.write(reinterpret_cast<const char *>(&tableSize), 4);
-        m_file.write(reinterpret_cast<const char *>(compressedTable.data()), compressedTable.size());
+        uint32_t sizes[2] = {static_cast<uint32_t>(compressedTable.size()), static_cast<uint32_t>(tableData.size())};
 
-        return m_file.good();
+        return m_file.WriteAt(46 + tableOffset, sizes, sizeof(sizes)) &&
+               m_file.WriteAt(46 + tableOffset + sizeof(sizes), compressedTable.data(), compressedTable.size());
     }
 
-    bool GrfFile::Merge(const GrfFile &other)
+    bool GrfFile::Merge(const GrfFile &other, const GrfMergeProgress &progress)
     {
-        // Copia todas as entradas do outro GRF
-        for (const auto &[name, entry] : other.m_entries)
+        /**
+         * Merge por cópia de blocos
+         *
+         * 1. Entradas gravadas do outro GRF são ordenadas por offset e agrupadas
+         *    em trechos contíguos
+         * 2. Cada trecho é copiado como está (comprimido/encriptado) para um espaço
+         *    livre deste GRF, sem descomprimir
+         * 3. As entradas apontam para a nova posição; a tabela é gravada no Save()
+         */
+        if (this == &other || !other.IsOpen() || !m_isOpen || !m_file.IsOpen())
+        {
+            OutputDebugStringA("[GRF] ERRO: Merge requer dois GRFs abertos e o destino em modo leitura/escrita\n");
+            return false;
+        }
+
+        struct SourceEntry
+        {
+            uint64_t offset;
+            uint64_t size;
+            uint32_t row;
+        };
+        std::vector<SourceEntry> sources;
+        sources.reserve(other.m_table.Size());
+
+        // Entradas ainda não salvas no outro GRF são copiadas da memória
+        for (uint32_t otherRow = 0; otherRow < other.m_table.Size(); otherRow++)
+        {
+            const EntryState *state = other.FindState(otherRow);
+            if (state && state->isDeleted)
+            {
+                continue;
+            }
+
+            if (state && !state->cachedData.empty())
+            {
+                bool exists = false;
+                uint32_t row = AcquireRow(other.m_index.Name(otherRow), exists);
+                if (row == GrfNameIndex::npos)
+                {
+                    continue;
+                }
+                CopyRowColumns(other, otherRow, row, m_table.offset[row]);
+
+                EntryState &newState = m_states[row];
+                newState = EntryState{};
+                newState.isNew = !exists;
+                newState.isModified = exists;
+                newState.cachedData = state->cachedData;
+                continue;
+            }
+
+            sources.push_back({other.m_table.offset[otherRow], other.m_table.compressedSizeAligned[otherRow], otherRow});
+        }
+
+        std::sort(sources.begin(), sources.end(), [](const SourceEntry &a, const SourceEntry &b)
+                  { return a.offset < b.offset; });
+
+        uint64_t totalBytes = 0;
+        for (const auto &source : sources)
+        {
+            totalBytes += source.size;
+        }
+
+        OutputDebugStringA(("[GRF] Merge: " + std::to_string(sources.size()) + " entradas, " +
+                            std::to_string(totalBytes) + " bytes\n")
+                               .c_str());
+
+        // Origem: mapeamento do outro GRF ou o próprio handle (leitura posicional)
+
+        uint64_t copiedBytes = 0;
+        size_t spanStart = 0;
+        while (spanStart < sources.size())
         {
-            // TODO: Copiar dados do arquivo
-            m_entries[name] = entry;
+            // Trecho contíguo (entradas que compartilham dados também entram)
+            uint64_t spanOffset = sources[spanStart].offset;
+            uint64_t spanEnd = spanOffset + sources[spanStart].size;
+            size_t spanLast = spanStart + 1;
+            while (spanLast < sources.size() && sources[spanLast].offset <= spanEnd)
+            {
+                spanEnd = std::max(spanEnd, sources[spanLast].offset + sources[spanLast].size);
+                spanLast++;
+            }
+
+            uint64_t spanSize = spanEnd - spanOffset;
+            uint64_t target = spanSize > 0 ? m_space.Allocate(spanSize) : 0;
+
+            // Copia em blocos grandes (progresso reportado a cada bloco)
+            constexpr uint64_t MERGE_CHUNK_SIZE = 64 * 1024 * 1024;
+            for (uint64_t done = 0; done < spanSize;)
+            {
+                uint64_t chunk = std::min(spanSize - done, MERGE_CHUNK_SIZE);
+
+                bool copied;
+                if (other.m_mapped.IsOpen())
+                {
+                    auto view = other.m_mapped.View(46 + spanOffset + done, static_cast<size_t>(chunk));
+                    copied = view.size() == chunk && m_file.WriteAt(46 + target + done, view.data(), view.size());
+                }
+                else
+                {
+                    copied = File::CopyRange(other.m_file, 46 + spanOffset + done, m_file, 46 + target + done, chunk);
+                }
+
+                if (!copied)
+                {
+                    OutputDebugStringA(("[GRF] ERRO: Falha ao copiar " + std::to_string(chunk) + " bytes do offset " +
+                                        std::to_string(spanOffset + done) + "\n")
+                                           .c_str());
+                    return false;
+                }
+
+                done += chunk;
+                copiedBytes += chunk;
+                if (progress)
+                {
+                    progress(copiedBytes, totalBytes);
+                }
+            }
+
+            // Entradas do trecho apontam para a cópia
+            for (size_t i = spanStart; i < spanLast; i++)
+            {
+                bool exists = false;
+                uint32_t row = AcquireRow(other.m_index.Name(sources[i].row), exists);
+                if (row == GrfNameIndex::npos)
+                {
+                    continue;
+                }
+                CopyRowColumns(other, sources[i].row, row, target + (sources[i].offset - spanOffset));
+                if (i > spanStart && sources[i].offset == sources[i - 1].offset && sources[i].size > 0)
+                {
+                    AddBlobRef(m_table.offset[row]);
+                }
+
+                // Dados já estão no arquivo: a linha não tem estado pendente
+                m_states.erase(row);
+            }
+
+            spanStart = spanLast;
         }
 
+        m_fileSize = std::max(m_fileSize, 46 + m_space.End());
         m_modified = true;
+
+        OutputDebugStringA(("[GRF] Merge concluído: " + std::to_string(copiedBytes) + " bytes copiados\n").c_str());
         return true;
     }
 
-    std::vector<uint8_t> GrfFile::Decompress(const std::vector<uint8_t> &data, size_t uncompressedSize)
+    uint32_t GrfFile::AcquireRow(std::string_view filename, bool &exists)
     {
-        std::vector<uint8_t> result(uncompressedSize);
+        bool inserted;
+        uint32_t row = m_index.FindOrInsert(filename, inserted);
+        exists = row != GrfNameIndex::npos && !inserted;
+        if (!exists)
+        {
+            if (row != GrfNameIndex::npos)
+            {
+                m_table.Append();
+            }
+            return row;
+        }
+
+        // Conteúdo antigo será substituído
+        ReleaseCommittedData(row);
+        return row;
+    }
 
-        uLongf destLen = static_cast<uLongf>(uncompressedSize);
-        int ret = uncompress(result.data(), &destLen, data.data(), static_cast<uLong>(data.size()));
+    void GrfFile::CopyRowColumns(const GrfFile &other, uint32_t otherRow, uint32_t row, uint64_t offset)
+    {
+        m_table.compressedSize[row] = other.m_table.compressedSize[otherRow];
+        m_table.compressedSizeAligned[row] = other.m_table.compressedSizeAligned[otherRow];
+        m_table.uncompressedSize[row] = other.m_table.uncompressedSize[otherRow];
+        m_table.offset[row] = offset;
+        m_table.flags[row] = other.m_table.flags[otherRow];
+    }
 
-        if (ret != Z_OK)
+    std::vector<uint8_t> GrfFile::Decompress(const std::vector<uint8_t> &data, size_t uncompressedSize)
+    {
+        std::vector<uint8_t> result;
+        if (!Decompress(data.data(), data.size(), uncompressedSize, result))
         {
             return {};
         }
-
-        result.resize(destLen);
         return result;
     }
 
-    std::vector<uint8_t> GrfFile::Compress(const std::vector<uint8_t> &data)
+    bool GrfFile::Decompress(const uint8_t *data, size_t size, size_t uncompressedSize, std::vector<uint8_t> &out)
+    {
+        return CodecContext::ForThread().Inflate(data, size, uncompressedSize, out);
+    }
+
+    bool GrfFile::ReadAt(uint64_t offset, void *dst, size_t size) const
     {
-        uLongf compressedSize = compressBound(static_cast<uLong>(data.size()));
-        std::vector<uint8_t> result(compressedSize);
+        if (size == 0)
+        {
+            return true;
+        }
 
-        int ret = compress(result.data(), &compressedSize, data.data(), static_cast<uLong>(data.size()));
+        if (m_mapped.IsOpen())
+        {
+            auto view = m_mapped.View(offset, size);
+            if (view.size() != size)
+            {
+                return false;
+            }
+            memcpy(dst, view.data(), size);
+            return true;
+        }
 
-        if (ret != Z_OK)
+        // Trecho ainda no buffer de write-behind (offsets do buffer são relativos ao header)
+        uint64_t tailStart = 46 + m_tailOffset;
+        uint64_t tailEnd = tailStart + m_tailBuffer.size();
+        if (!m_tailBuffer.empty() && offset < tailEnd && offset + size > tailStart)
         {
-            return {};
+            uint8_t *out = static_cast<uint8_t *>(dst);
+            if (offset < tailStart)
+            {
+                size_t head = static_cast<size_t>(tailStart - offset);
+                if (!m_file.ReadAt(offset, out, head))
+                {
+                    return false;
+                }
+                out += head;
+                offset += head;
+                size -= head;
+            }
+
+            size_t buffered = static_cast<size_t>(std::min<uint64_t>(size, tailEnd - offset));
+            memcpy(out, m_tailBuffer.data() + (offset - tailStart), buffered);
+            out += buffered;
+            offset += buffered;
+            size -= buffered;
+
+            return size == 0 || m_file.ReadAt(offset, out, size);
+        }
+
+        return m_file.ReadAt(offset, dst, size);
+    }
+
+    bool GrfFile::WriteIndexFile() const
+    {
+        GrfIndexKey key;
+        key.grfVersion = static_cast<uint32_t>(m_header.version);
+        key.tableOffset = m_tableRegionOffset;
+        key.fileCount = m_header.fileCount;
+        if (!GrfIndexFileStat(m_path, key.grfSize, key.grfMtime))
+        {
+            return false;
+        }
+
+        bool hasDeleted = false;
+        for (const auto &[row, state] : m_states)
+        {
+            hasDeleted = hasDeleted || state.isDeleted;
+        }
+
+        bool saved;
+        if (!hasDeleted)
+        {
+            saved = SaveGrfIndexFile(m_path + L".idx", key, m_tableRegionSize, m_index, m_table);
+        }
+        else
+        {
+            // Linhas removidas continuam na tabela em memória: grava só as vivas,
+            // como ficariam ao ler a tabela gravada
+            GrfNameIndex index;
+            GrfFileTable table;
+            index.Reserve(m_table.Size());
+            table.Reserve(m_table.Size());
+            for (uint32_t row = 0; row < m_table.Size(); row++)
+            {
+                if (IsDeleted(row))
+                {
+                    continue;
+                }
+                uint32_t liveRow = index.Insert(m_index.Name(row));
+                table.Append();
+                table.compressedSize[liveRow] = m_table.compressedSize[row];
+                table.compressedSizeAligned[liveRow] = m_table.compressedSizeAligned[row];
+                table.uncompressedSize[liveRow] = m_table.uncompressedSize[row];
+                table.offset[liveRow] = m_table.offset[row];
+                table.flags[liveRow] = m_table.flags[row];
+            }
+            saved = SaveGrfIndexFile(m_path + L".idx", key, m_tableRegionSize, index, table);
+        }
+
+        if (!saved)
+        {
+            OutputDebugStringA("[GRF] AVISO: Falha ao gravar índice .idx\n");
+        }
+        return saved;
+    }
+
+    void GrfFile::ReadRows(const uint32_t *rows, size_t count, std::vector<uint8_t> &arena,
+                           std::vector<std::span<const uint8_t>> &views, std::vector<uint8_t> &readOk) const
+    {
+        // Lacuna máxima lida (e descartada) entre duas entradas para manter uma única
+        // leitura, e tamanho máximo de cada leitura
+        constexpr uint64_t MAX_GAP = 64 * 1024;
+        constexpr uint64_t MAX_RUN = 8 * 1024 * 1024;
+
+        struct Run
+        {
+            uint64_t start = 0; // Offset no arquivo
+            uint64_t end = 0;
+            size_t arenaPos = 0;
+            size_t firstItem = 0; // Índice em 'items'
+            size_t itemCount = 0;
+        };
+
+        views.assign(count, {});
+        readOk.assign(count, 0);
+
+        std::vector<size_t> items; // Entradas que precisam ser lidas, em ordem de offset
+        std::vector<Run> runs;
+        size_t arenaSize = 0;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t row = rows[i];
+            uint32_t compressedSize = m_table.compressedSize[row];
+            auto state = FindState(row);
+            bool encrypted = (m_table.flags[row] & (GRFFILE_FLAG_MIXCRYPT | GRFFILE_FLAG_DES)) != 0;
+            uint64_t offset = m_table.offset[row] + 46ull;
+
+            if (state && !state->cachedData.empty())
+            {
+                views[i] = {state->cachedData.data(), compressedSize};
+                readOk[i] = true;
+                continue;
+            }
+            if (m_mapped.IsOpen() && !encrypted)
+            {
+                views[i] = m_mapped.View(offset, compressedSize);
+                readOk[i] = views[i].size() == compressedSize;
+                continue;
+            }
+
+            // Entradas sobrepostas não dividem bytes da arena: a decriptação é feita no lugar
+            uint64_t end = offset + m_table.compressedSizeAligned[row];
+            bool extend = !runs.empty() && offset >= runs.back().end &&
+                          offset - runs.back().end <= MAX_GAP && end - runs.back().start <= MAX_RUN;
+            if (extend)
+            {
+                arenaSize += static_cast<size_t>(end - runs.back().end);
+                runs.back().end = end;
+                runs.back().itemCount++;
+            }
+            else
+            {
+                Run run;
+                run.start = offset;
+                run.end = end;
+                run.arenaPos = arenaSize;
+                run.firstItem = items.size();
+                run.itemCount = 1;
+                runs.push_back(run);
+                arenaSize += static_cast<size_t>(end - offset);
+            }
+            items.push_back(i);
+        }
+
+        arena.resize(arenaSize);
+
+        for (const Run &run : runs)
+        {
+            uint8_t *base = arena.data() + run.arenaPos;
+            bool ok = ReadAt(run.start, base, static_cast<size_t>(run.end - run.start));
+
+            for (size_t k = 0; k < run.itemCount; k++)
+            {
+                size_t i = items[run.firstItem + k];
+                uint32_t row = rows[i];
+                uint64_t offset = m_table.offset[row] + 46ull;
+                uint32_t aligned = m_table.compressedSizeAligned[row];
+                uint8_t *dst = base + (offset - run.start);
+
+                views[i] = {dst, aligned};
+                // Se a leitura conjunta falhar (ex.: arquivo truncado), tenta cada entrada
+                // separadamente para não perder as que estão íntegras
+                readOk[i] = ok || (run.itemCount > 1 && ReadAt(offset, dst, aligned));
+            }
         }
+    }
 
-        result.resize(compressedSize);
+    std::vector<uint8_t> GrfFile::Compress(const std::vector<uint8_t> &data)
+    {
+        std::vector<uint8_t> result;
+        if (!CodecContext::ForThread().Deflate(data.data(), data.size(), result))
+        {
+            return {};
+        }
         return result;
     }
 
-    void GrfFile::DecryptEntry(std::vector<uint8_t> &data, const GrfEntry &entry)
+    void GrfFile::DecryptEntry(std::vector<uint8_t> &data, uint8_t flags, uint32_t compressedSize)
     {
-        if (!(entry.flags & (GRFFILE_FLAG_MIXCRYPT | GRFFILE_FLAG_DES)))
+        if (!(flags & (GRFFILE_FLAG_MIXCRYPT | GRFFILE_FLAG_DES)))
         {
             return; // Não está encriptado
         }
 
-        // TODO: Implementar DES decryption para GRF
-        // A implementação completa requer as tabelas DES específicas do GRF
+        uint32_t cycle = (flags & GRFFILE_FLAG_MIXCRYPT) ? GrfDesCycle(compressedSize) : 0;
+        GrfDecodeEntry(data.data(), data.size(), flags, cycle);
     }
 
     void GrfFile::EncryptEntry(std::vector<uint8_t> &data, GrfEntry &entry)
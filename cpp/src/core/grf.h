@@ -1,10 +1,19 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <cstdint>
-#include <fstream>
+#include <span>
+#include "file_io.h"
+#include "codec.h"
+#include "grf_table.h"
+#include "grf_space.h"
+#include "thread_pool.h"
 
 namespace autopatch
 {
@@ -15,7 +24,15 @@ namespace autopatch
         V0x101 = 0x101,
         V0x102 = 0x102,
         V0x103 = 0x103,
-        V0x200 = 0x200
+        V0x200 = 0x200,
+        V0x300 = 0x300 // Offsets de 64 bits (arquivos > 4 GB)
+    };
+
+    // Modo de abertura do GRF
+    enum class GrfOpenMode
+    {
+        ReadWrite,     // Leitura/escrita via stream (necessário para patching)
+        ReadOnlyMapped // Somente leitura, arquivo mapeado em memória (zero-copy)
     };
 
     // Flags de entrada GRF
@@ -26,14 +43,14 @@ namespace autopatch
         GRFFILE_FLAG_DES = 0x04
     };
 
-    // Entrada de arquivo no GRF
+    // Entrada de arquivo no GRF (materializada sob demanda a partir da tabela em colunas)
     struct GrfEntry
     {
-        std::string filename;               // Nome do arquivo (em encoding coreano)
+        std::string_view filename;          // Nome do arquivo (em encoding coreano, aponta para o índice do GRF)
         uint32_t compressedSize = 0;        // Tamanho comprimido
         uint32_t compressedSizeAligned = 0; // Tamanho alinhado
         uint32_t uncompressedSize = 0;      // Tamanho original
-        uint32_t offset = 0;                // Offset no arquivo GRF
+        uint64_t offset = 0;                // Offset no arquivo GRF
         uint8_t flags = 0;                  // Flags
         uint32_t cycle = 0;                 // Cycle para DES
 
@@ -41,7 +58,6 @@ namespace autopatch
         bool isNew = false;              // Arquivo novo (não existe no GRF original)
         bool isModified = false;         // Arquivo modificado
         bool isDeleted = false;          // Arquivo marcado para deleção
-        std::vector<uint8_t> cachedData; // Dados comprimidos em cache (para novos/modificados)
     };
 
     // Header do arquivo GRF
@@ -49,12 +65,61 @@ namespace autopatch
     {
         char signature[16];        // "Master of Magic\0"
         uint8_t encryptionKey[14]; // Chave de encriptação
-        uint32_t fileTableOffset;  // Offset da tabela de arquivos
-        uint32_t seed;             // Seed
+        uint64_t fileTableOffset;  // Offset da tabela de arquivos (64 bits em 0x300)
+        uint32_t seed;             // Seed (ausente em 0x300)
         uint32_t fileCount;        // Número de arquivos
         GrfVersion version;        // Versão
     };
 
+    // Uso de memória da tabela de arquivos carregada
+    struct GrfMemoryStats
+    {
+        size_t entryCount = 0;   // Entradas na tabela
+        size_t tableBytes = 0;   // Colunas da tabela (tamanhos, offsets, flags)
+        size_t indexBytes = 0;   // Slots do índice hash + colunas por nome
+        size_t nameBytes = 0;    // Arena de nomes
+        size_t overlayBytes = 0; // Estado de entradas tocadas + dados em cache
+
+        size_t TotalBytes() const { return tableBytes + indexBytes + nameBytes + overlayBytes; }
+        size_t BytesPerEntry() const { return entryCount ? TotalBytes() / entryCount : 0; }
+    };
+
+    // Arquivo a adicionar em lote
+    struct GrfAddItem
+    {
+        std::string filename;
+        std::vector<uint8_t> data; // Dados originais (não comprimidos)
+    };
+
+    // Progresso do Merge: bytes copiados / total
+    using GrfMergeProgress = std::function<void(uint64_t copiedBytes, uint64_t totalBytes)>;
+
+    // Progresso da extração em massa: arquivos concluídos / total. Retornar false cancela.
+    using GrfExtractProgress = std::function<bool(uint64_t doneFiles, uint64_t totalFiles)>;
+
+    // Visitante de nomes (views válidas até Close). Retornar false interrompe.
+    using GrfFileVisitor = std::function<bool(std::string_view filename)>;
+
+    // Resultado de ExtractBatch: 'index' é a posição do nome na lista pedida. 'data' só é
+    // válido durante a chamada; 'ok' = false se o arquivo não existe ou falhou.
+    using GrfBatchSink = std::function<void(size_t index, const std::string &filename, std::span<const uint8_t> data, bool ok)>;
+
+    // Ocupação do arquivo GRF (relatório de fragmentação)
+    struct GrfSpaceStats
+    {
+        uint64_t fileSize = 0;      // Tamanho do arquivo em disco
+        uint64_t liveBytes = 0;     // Dados de entradas gravadas e vivas (tamanho alinhado)
+        uint64_t tableBytes = 0;    // Tabela de arquivos gravada
+        uint64_t holeBytes = 0;     // Buracos reutilizáveis por novas entradas
+        uint64_t pendingBytes = 0;  // Liberados nesta sessão (reutilizáveis após o próximo Save)
+        uint64_t trailingBytes = 0; // Após o fim da área de dados
+        size_t holeCount = 0;
+        uint64_t largestHole = 0;
+
+        uint64_t DeadBytes() const { return holeBytes + pendingBytes + trailingBytes; }
+        double DeadRatio() const { return fileSize ? static_cast<double>(DeadBytes()) / fileSize : 0.0; }
+    };
+
     // Classe para leitura/escrita de arquivos GRF
     class GrfFile
     {
@@ -63,7 +128,25 @@ namespace autopatch
         ~GrfFile();
 
         // Abre um arquivo GRF existente
-        bool Open(const std::wstring &path);
+        bool Open(const std::wstring &path, GrfOpenMode mode = GrfOpenMode::ReadWrite);
+
+        // Usa um índice persistido (<grf>.idx) com a tabela já parseada: se corresponder ao
+        // GRF (versão, tamanho, data, offset da tabela e contagem do header), Open carrega o
+        // índice sem ler a tabela do GRF. O índice é (re)gravado no Close quando a tabela
+        // foi lida do GRF ou regravada. Deve ser chamado antes de Open/Create.
+        void SetUseIndexFile(bool enabled) { m_useIndexFile = enabled; }
+
+        // Write-behind: cada entrada adicionada é gravada no fim do GRF assim que comprimida
+        // (por um buffer de coalescência de 8 MB), em vez de ficar em memória até
+        // o Save(), que passa a gravar só a tabela e o header. A memória não depende do
+        // tamanho do patch; buracos do arquivo não são reaproveitados por essas entradas.
+        void SetWriteBehind(bool enabled) { m_writeBehind = enabled; }
+
+        // Deduplicação por conteúdo: AddFile/AddFiles calculam um hash dos dados descomprimidos
+        // e, se um arquivo idêntico (conferido byte a byte) já foi adicionado nesta sessão, a
+        // nova entrada aponta para os mesmos bytes comprimidos em vez de gravar outra cópia.
+        // Uma região compartilhada só é liberada quando a última entrada deixa de usá-la.
+        void SetDeduplicate(bool enabled) { m_deduplicate = enabled; }
 
         // Cria um novo arquivo GRF
         bool Create(const std::wstring &path, GrfVersion version = GrfVersion::V0x200);
@@ -74,58 +157,234 @@ namespace autopatch
         // Verifica se está aberto
         bool IsOpen() const { return m_isOpen; }
 
+        // Verifica se foi aberto em modo mapeado (somente leitura)
+        bool IsMapped() const { return m_mapped.IsOpen(); }
+
         // Obtém a versão
         GrfVersion GetVersion() const { return m_header.version; }
 
         // Obtém número de arquivos
-        size_t GetFileCount() const { return m_entries.size(); }
+        size_t GetFileCount() const { return m_table.Size(); }
 
         // Lista todos os arquivos
         std::vector<std::string> GetFileList() const;
 
+        // Visita os nomes das entradas sem copiar, na ordem da tabela
+        void ForEachFile(const GrfFileVisitor &visit) const;
+
+        // Nomes que casam com 'pattern' ('*' e '?'; ignora maiúsculas/minúsculas e aceita
+        // '/' ou '\'), em ordem alfabética. O trecho antes do primeiro curinga é localizado
+        // por busca binária num índice ordenado (criado no primeiro uso), então consultas
+        // por diretório como "data\sprite\*" custam O(log n + k). Retorna quantos nomes casaram.
+        size_t FindFiles(std::string_view pattern, const GrfFileVisitor &visit) const;
+        std::vector<std::string_view> FindFiles(std::string_view pattern) const;
+
         // Verifica se um arquivo existe
         bool FileExists(const std::string &filename) const;
 
         // Obtém informações de um arquivo
-        const GrfEntry *GetEntry(const std::string &filename) const;
+        // (busca ignora maiúsculas/minúsculas e aceita '/' ou '\' como separador)
+        // A entrada é montada a partir das colunas da tabela e retornada por valor: nada fica
+        // guardado no GrfFile. 'filename' aponta para o índice e vale até Close(). Pode ser
+        // chamado por várias threads ao mesmo tempo, desde que nenhuma escrita rode em paralelo.
+        std::optional<GrfEntry> GetEntry(const std::string &filename) const;
+
+        // Busca em lote: resultado[i] corresponde a filenames[i] (vazio se não existir)
+        std::vector<std::optional<GrfEntry>> GetEntries(const std::vector<std::string> &filenames) const;
+
+        // Uso de memória da tabela de arquivos
+        GrfMemoryStats GetMemoryStats() const;
+
+        // Bytes vivos x bytes mortos (buracos, espaço liberado, sobra no fim do arquivo)
+        GrfSpaceStats GetSpaceStats() const;
+
+        // Bytes (alinhados) que a deduplicação deixou de gravar nesta sessão
+        uint64_t GetDedupSavedBytes() const { return m_dedupSavedBytes; }
+
+        // Leitura concorrente: ExtractFile, ExtractView, ExtractFileTo e ReadCompressed usam
+        // E/S posicional e estado local à chamada, então várias threads podem extrair do mesmo
+        // GrfFile ao mesmo tempo, desde que nenhuma operação de escrita rode em paralelo.
 
         // Extrai um arquivo para memória
-        std::vector<uint8_t> ExtractFile(const std::string &filename);
+        std::vector<uint8_t> ExtractFile(const std::string &filename) const;
+
+        // Lê um arquivo evitando cópias:
+        // - entradas armazenadas sem compressão retornam uma view direto do mapeamento
+        // - entradas comprimidas são descomprimidas em 'buffer' e a view aponta para ele
+        // A view é válida até o próximo uso de 'buffer' ou até Close()
+        std::span<const uint8_t> ExtractView(const std::string &filename, std::vector<uint8_t> &buffer) const;
+
+        // Extrai para 'out' reaproveitando a capacidade já alocada. Com o mesmo 'out' entre
+        // chamadas, a extração não aloca (zlib e buffers temporários vêm do contexto da thread).
+        bool ExtractInto(const std::string &filename, std::vector<uint8_t> &out) const;
 
         // Extrai um arquivo para disco
-        bool ExtractFileTo(const std::string &filename, const std::wstring &outputPath);
+        bool ExtractFileTo(const std::string &filename, const std::wstring &outputPath) const;
+
+        // Extrai todos os arquivos para 'outputDir', recriando os subdiretórios do GRF.
+        // Pipeline: uma thread lê lotes de entradas em ordem de offset (leitura sequencial)
+        // enquanto o pool (nullptr = ThreadPool::Default()) decripta, descomprime e grava
+        // o lote anterior. Retorna false se algum arquivo falhar ou se for cancelado.
+        bool ExtractAll(const std::wstring &outputDir, const GrfExtractProgress &progress = nullptr, ThreadPool *pool = nullptr) const;
+
+        // Extrai vários arquivos de uma vez: os pedidos são ordenados por offset e entradas
+        // vizinhas são lidas numa única leitura sequencial. O sink recebe cada arquivo em
+        // ordem física (não na ordem de 'names'), identificado pelo índice original.
+        // Retorna false se algum arquivo não existir ou falhar.
+        bool ExtractBatch(const std::vector<std::string> &names, const GrfBatchSink &sink) const;
 
         // Adiciona/substitui um arquivo
         bool AddFile(const std::string &filename, const std::vector<uint8_t> &data);
+
+        // Adiciona/substitui um arquivo do disco em stream: a compressão é feita em blocos
+        // gravados direto no fim do GRF (memória limitada a poucos MB, seja qual for o
+        // tamanho do arquivo). A entrada passa a valer na tabela gravada pelo Save().
         bool AddFile(const std::string &filename, const std::wstring &sourcePath);
 
+        // Mesmo que o anterior, com os dados vindos de 'read' (exatamente 'size' bytes)
+        bool AddFile(const std::string &filename, const CodecContext::StreamReader &read, uint64_t size);
+
+        // Adiciona/substitui vários arquivos: a compressão roda em paralelo no pool
+        // (nullptr = ThreadPool::Default()) e as entradas são aplicadas na ordem de 'items',
+        // então o GRF resultante é o mesmo de chamadas sequenciais de AddFile.
+        // Retorna quantos arquivos foram adicionados.
+        size_t AddFiles(std::vector<GrfAddItem> items, ThreadPool *pool = nullptr);
+
+        // Adiciona/substitui um arquivo a partir de dados já comprimidos, sem recomprimir.
+        // Aceita stream zlib (copiado como está) ou deflate puro (recebe o wrapper zlib).
+        bool AddCompressedFile(const std::string &filename, std::vector<uint8_t> deflateBytes, uint32_t uncompressedSize);
+
+        // Adiciona/substitui um arquivo a partir de um stream deflate puro lido em blocos e
+        // gravado direto no fim do GRF com o wrapper zlib (memória limitada, como AddFile
+        // em stream). Retorna false se o stream não for deflate puro válido com esse tamanho.
+        bool AddCompressedFile(const std::string &filename, const CodecContext::StreamReader &read, uint32_t uncompressedSize);
+
+        // Lê o stream zlib de uma entrada sem descomprimir (já decriptado).
+        // Retorna false se a entrada não existir ou estiver armazenada sem compressão.
+        bool ReadCompressed(const std::string &filename, std::vector<uint8_t> &out, uint32_t &uncompressedSize) const;
+
         // Remove um arquivo
         bool RemoveFile(const std::string &filename);
 
         // Salva alterações (repack)
         bool Save();
 
-        // Mescla outro GRF neste (para patching)
-        bool Merge(const GrfFile &other);
+        // Fecha o GRF sem salvar: as alterações pendentes (entradas novas, removidas, buffer
+        // do write-behind) são descartadas e o que foi gravado além do fim do arquivo no
+        // último estado salvo é cortado. O header e a tabela gravados continuam valendo.
+        void Discard();
+
+        // Compactação incremental: move até 'byteBudget' bytes (0 = sem limite) de entradas
+        // para buracos mais próximos do início, copiando os bytes comprimidos sem recomprimir,
+        // e grava uma nova tabela. Cada passo deixa o GRF consistente e pode ser retomado
+        // em outra execução. 'finished' indica que nada mais pode ser movido e o fim do
+        // arquivo foi truncado; um passo que não move nada não regrava a tabela (só a desce,
+        // se couber num buraco abaixo dela).
+        bool CompactStep(uint64_t byteBudget, bool &finished);
+
+        // Mescla outro GRF neste (para patching): os blocos comprimidos das entradas
+        // são copiados como estão, em trechos contíguos, sem descomprimir
+        bool Merge(const GrfFile &other, const GrfMergeProgress &progress = nullptr);
 
     private:
+        // Estado de patching de uma linha; só existe para entradas tocadas
+        struct EntryState
+        {
+            bool isNew = false;
+            bool isModified = false;
+            bool isDeleted = false;
+            std::vector<uint8_t> cachedData; // Dados comprimidos em cache (para novos/modificados)
+        };
+
+        const EntryState *FindState(uint32_t row) const;
+        bool IsDeleted(uint32_t row) const;
+        bool IsCommitted(uint32_t row) const;
+        GrfEntry MakeEntry(uint32_t row) const;
+        void BuildFreeSpace();
+        void ReleaseCommittedData(uint32_t row);
+        void AddBlobRef(uint64_t offset);
+        void CommitFreeSpace(uint64_t tableOffset, uint64_t tableSize);
+
+        uint32_t AcquireRow(std::string_view filename, bool &exists);
+        void CopyRowColumns(const GrfFile &other, uint32_t otherRow, uint32_t row, uint64_t offset);
+        bool StoreCompressed(const std::string &filename, std::vector<uint8_t> compressed, uint32_t uncompressedSize);
+        bool StoreAtTail(const std::string &filename, const std::vector<uint8_t> &compressed, uint32_t uncompressedSize);
+        bool AppendToTail(uint64_t offset, const uint8_t *data, size_t size, size_t alignedSize);
+        bool FlushTail();
+        uint64_t StreamStart() const;
+        void DiscardStreamed(uint64_t fileEnd, uint64_t writtenEnd);
+        bool StoreStreamed(const std::string &filename, uint64_t start, uint32_t compressedSize, uint32_t uncompressedSize);
+        bool StoreDuplicate(const std::string &filename, const std::vector<uint8_t> &data, uint64_t hash);
+        bool WritePending(uint32_t row);
+        void RecordContent(const std::string &filename, uint64_t hash);
+
+        bool ReadEntry(const std::string &filename, std::vector<uint8_t> &buffer, std::span<const uint8_t> &view) const;
+
         bool ReadHeader();
         bool ReadFileTable();
+        bool ReadLegacyFileTable();
         bool WriteHeader();
-        bool WriteFileTable();
+        bool NeedsLargeOffsets() const;
+        bool WriteFileTable(uint64_t &tableRegionSize, bool lowest = false);
+        bool CommitTable(bool lowestTable); // Tabela + header; libera o espaço antigo
+        bool TruncateToDataEnd();
         bool WriteFileData(); // QuickMerge - escreve apenas novos/modificados
+        bool ReadAt(uint64_t offset, void *dst, size_t size) const;
+        bool WriteIndexFile() const;
+        const std::vector<uint32_t> &SortedRows() const;
 
-        std::vector<uint8_t> Decompress(const std::vector<uint8_t> &data, size_t uncompressedSize);
-        std::vector<uint8_t> Compress(const std::vector<uint8_t> &data);
-        void DecryptEntry(std::vector<uint8_t> &data, const GrfEntry &entry);
+        // Lê os bytes comprimidos (alinhados, ainda encriptados) de 'rows', já em ordem de
+        // offset, juntando entradas próximas em leituras únicas para 'arena'. views[i] aponta
+        // para a arena, o mapeamento ou o cache da entrada.
+        void ReadRows(const uint32_t *rows, size_t count, std::vector<uint8_t> &arena,
+                      std::vector<std::span<const uint8_t>> &views, std::vector<uint8_t> &readOk) const;
+
+        static std::vector<uint8_t> Decompress(const std::vector<uint8_t> &data, size_t uncompressedSize);
+        static bool Decompress(const uint8_t *data, size_t size, size_t uncompressedSize, std::vector<uint8_t> &out);
+        static std::vector<uint8_t> Compress(const std::vector<uint8_t> &data);
+        static void DecryptEntry(std::vector<uint8_t> &data, uint8_t flags, uint32_t compressedSize);
         void EncryptEntry(std::vector<uint8_t> &data, GrfEntry &entry);
 
         std::wstring m_path;
-        std::fstream m_file;
+        File m_file;
+        MappedFile m_mapped; // Usado apenas em GrfOpenMode::ReadOnlyMapped
         bool m_isOpen = false;
         bool m_modified = false;
         GrfHeader m_header = {};
-        std::map<std::string, GrfEntry> m_entries;
+        GrfNameIndex m_index;                                         // Nome -> linha
+        GrfFileTable m_table;                                         // Colunas indexadas pela linha do m_index
+        std::unordered_map<uint32_t, EntryState> m_states;            // Overlay esparso de entradas tocadas
+
+        // Linhas em ordem alfabética (normalizada) para FindFiles; linhas novas são
+        // intercaladas sob demanda (nomes nunca mudam, só são acrescentados)
+        mutable std::vector<uint32_t> m_sortedRows;
+        mutable std::mutex m_sortedMutex;
+
+        // Espaço livre: regiões referenciadas pela tabela gravada só voltam
+        // ao alocador depois que a nova tabela e o header forem gravados
+        GrfSpaceAllocator m_space;
+        std::vector<std::pair<uint64_t, uint64_t>> m_released; // {offset, tamanho} liberados nesta sessão
+        uint64_t m_tableRegionOffset = 0;                      // Tabela gravada (relativo ao fim do header)
+        uint64_t m_tableRegionSize = 0;
+        uint64_t m_fileSize = 0;
+        uint64_t m_committedFileSize = 0; // Tamanho em disco no último estado salvo (Open/Save)
+
+        // Índice persistido (.idx)
+        bool m_useIndexFile = false;
+        bool m_indexDirty = false; // Tabela em memória difere do .idx (lida do GRF ou regravada)
+
+        // Write-behind: bytes de [m_tailOffset, m_tailOffset + size) ainda não gravados
+        static constexpr size_t TAIL_BUFFER_SIZE = 8 * 1024 * 1024;
+        bool m_writeBehind = false;
+        std::vector<uint8_t> m_tailBuffer;
+        uint64_t m_tailOffset = 0;
+
+        // Deduplicação: regiões compartilhadas guardam quantas linhas gravadas as referenciam
+        bool m_deduplicate = false;
+        std::unordered_map<uint64_t, uint32_t> m_contentRows; // Hash do conteúdo -> última linha com ele
+        std::unordered_map<uint64_t, uint32_t> m_blobRefs;    // Offset -> referências (só regiões com mais de uma)
+        uint64_t m_dedupSavedBytes = 0;
+        size_t m_dedupCount = 0;
     };
 
 } // namespace autopatch
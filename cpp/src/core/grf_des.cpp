@@ -0,0 +1,279 @@
+#include "grf_des.h"
+#include <array>
+
+namespace autopatch
+{
+
+    // Flags de entrada (mesmos valores de GrfEntryFlags em grf.h)
+    static constexpr uint8_t FLAG_MIXCRYPT = 0x02;
+    static constexpr uint8_t FLAG_DES = 0x04;
+
+    // Permutação inicial (IP), numeração de bits 1..64 a partir do MSB do primeiro byte
+    static constexpr uint8_t IP_TABLE[64] = {
+        58, 50, 42, 34, 26, 18, 10, 2,
+        60, 52, 44, 36, 28, 20, 12, 4,
+        62, 54, 46, 38, 30, 22, 14, 6,
+        64, 56, 48, 40, 32, 24, 16, 8,
+        57, 49, 41, 33, 25, 17, 9, 1,
+        59, 51, 43, 35, 27, 19, 11, 3,
+        61, 53, 45, 37, 29, 21, 13, 5,
+        63, 55, 47, 39, 31, 23, 15, 7};
+
+    // Permutação final (IP^-1)
+    static constexpr uint8_t FP_TABLE[64] = {
+        40, 8, 48, 16, 56, 24, 64, 32,
+        39, 7, 47, 15, 55, 23, 63, 31,
+        38, 6, 46, 14, 54, 22, 62, 30,
+        37, 5, 45, 13, 53, 21, 61, 29,
+        36, 4, 44, 12, 52, 20, 60, 28,
+        35, 3, 43, 11, 51, 19, 59, 27,
+        34, 2, 42, 10, 50, 18, 58, 26,
+        33, 1, 41, 9, 49, 17, 57, 25};
+
+    // Transposição (P-box) aplicada à saída das S-boxes
+    static constexpr uint8_t TP_TABLE[32] = {
+        16, 7, 20, 21, 29, 12, 28, 17,
+        1, 15, 23, 26, 5, 18, 31, 10,
+        2, 8, 24, 14, 32, 27, 3, 9,
+        19, 13, 30, 6, 22, 11, 4, 25};
+
+    // S-boxes padrão do DES (4 linhas x 16 colunas)
+    static constexpr uint8_t SBOX_TABLE[8][64] = {
+        {14, 4, 13, 1, 2, 15, 11, 8, 3, 10, 6, 12, 5, 9, 0, 7,
+         0, 15, 7, 4, 14, 2, 13, 1, 10, 6, 12, 11, 9, 5, 3, 8,
+         4, 1, 14, 8, 13, 6, 2, 11, 15, 12, 9, 7, 3, 10, 5, 0,
+         15, 12, 8, 2, 4, 9, 1, 7, 5, 11, 3, 14, 10, 0, 6, 13},
+        {15, 1, 8, 14, 6, 11, 3, 4, 9, 7, 2, 13, 12, 0, 5, 10,
+         3, 13, 4, 7, 15, 2, 8, 14, 12, 0, 1, 10, 6, 9, 11, 5,
+         0, 14, 7, 11, 10, 4, 13, 1, 5, 8, 12, 6, 9, 3, 2, 15,
+         13, 8, 10, 1, 3, 15, 4, 2, 11, 6, 7, 12, 0, 5, 14, 9},
+        {10, 0, 9, 14, 6, 3, 15, 5, 1, 13, 12, 7, 11, 4, 2, 8,
+         13, 7, 0, 9, 3, 4, 6, 10, 2, 8, 5, 14, 12, 11, 15, 1,
+         13, 6, 4, 9, 8, 15, 3, 0, 11, 1, 2, 12, 5, 10, 14, 7,
+         1, 10, 13, 0, 6, 9, 8, 7, 4, 15, 14, 3, 11, 5, 2, 12},
+        {7, 13, 14, 3, 0, 6, 9, 10, 1, 2, 8, 5, 11, 12, 4, 15,
+         13, 8, 11, 5, 6, 15, 0, 3, 4, 7, 2, 12, 1, 10, 14, 9,
+         10, 6, 9, 0, 12, 11, 7, 13, 15, 1, 3, 14, 5, 2, 8, 4,
+         3, 15, 0, 6, 10, 1, 13, 8, 9, 4, 5, 11, 12, 7, 2, 14},
+        {2, 12, 4, 1, 7, 10, 11, 6, 8, 5, 3, 15, 13, 0, 14, 9,
+         14, 11, 2, 12, 4, 7, 13, 1, 5, 0, 15, 10, 3, 9, 8, 6,
+         4, 2, 1, 11, 10, 13, 7, 8, 15, 9, 12, 5, 6, 3, 0, 14,
+         11, 8, 12, 7, 1, 14, 2, 13, 6, 15, 0, 9, 10, 4, 5, 3},
+        {12, 1, 10, 15, 9, 2, 6, 8, 0, 13, 3, 4, 14, 7, 5, 11,
+         10, 15, 4, 2, 7, 12, 9, 5, 6, 1, 13, 14, 0, 11, 3, 8,
+         9, 14, 15, 5, 2, 8, 12, 3, 7, 0, 4, 10, 1, 13, 11, 6,
+         4, 3, 2, 12, 9, 5, 15, 10, 11, 14, 1, 7, 6, 0, 8, 13},
+        {4, 11, 2, 14, 15, 0, 8, 13, 3, 12, 9, 7, 5, 10, 6, 1,
+         13, 0, 11, 7, 4, 9, 1, 10, 14, 3, 5, 12, 2, 15, 8, 6,
+         1, 4, 11, 13, 12, 3, 7, 14, 10, 15, 6, 8, 0, 5, 9, 2,
+         6, 11, 13, 8, 1, 4, 10, 7, 9, 5, 0, 15, 14, 2, 3, 12},
+        {13, 2, 8, 4, 6, 15, 11, 1, 10, 9, 3, 14, 5, 0, 12, 7,
+         1, 15, 13, 8, 10, 3, 7, 4, 12, 5, 6, 11, 0, 14, 9, 2,
+         7, 11, 4, 1, 9, 12, 14, 2, 0, 6, 10, 13, 15, 3, 5, 8,
+         2, 1, 14, 7, 4, 10, 8, 13, 15, 12, 9, 0, 3, 5, 6, 11}};
+
+    using PermutationTable = std::array<std::array<uint64_t, 256>, 8>;
+    using SpTable = std::array<std::array<uint32_t, 64>, 8>;
+
+    // Permutação de 64 bits decomposta por byte: resultado = OR de table[posição][valor do byte]
+    static constexpr PermutationTable MakePermutationTable(const uint8_t (&permutation)[64])
+    {
+        PermutationTable table{};
+        for (int i = 0; i < 64; i++)
+        {
+            int source = permutation[i] - 1;
+            int position = source >> 3;
+            uint8_t mask = static_cast<uint8_t>(0x80 >> (source & 7));
+            for (int value = 0; value < 256; value++)
+            {
+                if (value & mask)
+                {
+                    table[position][value] |= 1ull << (63 - i);
+                }
+            }
+        }
+        return table;
+    }
+
+    // S-box k seguida da P-box: cada entrada já é a contribuição final de 32 bits do grupo de 6 bits
+    static constexpr SpTable MakeSpTable()
+    {
+        SpTable table{};
+        for (int k = 0; k < 8; k++)
+        {
+            for (int value = 0; value < 64; value++)
+            {
+                int row = ((value >> 4) & 2) | (value & 1);
+                int column = (value >> 1) & 15;
+                uint32_t sboxOut = static_cast<uint32_t>(SBOX_TABLE[k][row * 16 + column]) << (28 - 4 * k);
+
+                uint32_t permuted = 0;
+                for (int i = 0; i < 32; i++)
+                {
+                    if (sboxOut & (1u << (31 - (TP_TABLE[i] - 1))))
+                    {
+                        permuted |= 1u << (31 - i);
+                    }
+                }
+                table[k][value] = permuted;
+            }
+        }
+        return table;
+    }
+
+    static constexpr PermutationTable IP_LOOKUP = MakePermutationTable(IP_TABLE);
+    static constexpr PermutationTable FP_LOOKUP = MakePermutationTable(FP_TABLE);
+    static constexpr SpTable SP_LOOKUP = MakeSpTable();
+
+    void GrfDesDecryptBlock(uint8_t *block)
+    {
+        uint64_t x = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            x |= IP_LOOKUP[i][block[i]];
+        }
+
+        // Rodada única: L ^= P(S(E(R))), sem chave e sem troca das metades
+        uint32_t left = static_cast<uint32_t>(x >> 32);
+        uint32_t right = static_cast<uint32_t>(x);
+
+        // Expansão E: grupo k = bits 4k..4k+5 de (R32, R1..R32, R1)
+        uint64_t expanded = (static_cast<uint64_t>(right & 1) << 33) | (static_cast<uint64_t>(right) << 1) | (right >> 31);
+
+        uint32_t f = 0;
+        for (int k = 0; k < 8; k++)
+        {
+            f |= SP_LOOKUP[k][(expanded >> (28 - 4 * k)) & 0x3F];
+        }
+        left ^= f;
+
+        x = (static_cast<uint64_t>(left) << 32) | right;
+
+        uint64_t y = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            y |= FP_LOOKUP[i][(x >> (56 - 8 * i)) & 0xFF];
+        }
+
+        for (int i = 0; i < 8; i++)
+        {
+            block[i] = static_cast<uint8_t>(y >> (56 - 8 * i));
+        }
+    }
+
+    uint32_t GrfDesCycle(uint32_t compressedSize)
+    {
+        uint32_t digits = 1;
+        for (uint64_t i = 10; i <= compressedSize; i *= 10)
+        {
+            digits++;
+        }
+
+        // dígitos: 1  2  3  4  5  6  7  8  9 ...
+        //  cycle:  1  1  4  5 14 15 22 23 24 ...
+        if (digits < 3)
+        {
+            return 1;
+        }
+        if (digits < 5)
+        {
+            return digits + 1;
+        }
+        if (digits < 7)
+        {
+            return digits + 9;
+        }
+        return digits + 15;
+    }
+
+    // Tabela de substituição do último byte de blocos embaralhados (involução)
+    static constexpr std::array<uint8_t, 256> MakeShuffleSubstitution()
+    {
+        std::array<uint8_t, 256> table{};
+        for (int i = 0; i < 256; i++)
+        {
+            table[i] = static_cast<uint8_t>(i);
+        }
+
+        constexpr uint8_t pairs[][2] = {
+            {0x00, 0x2B}, {0x6C, 0x80}, {0x01, 0x68}, {0x48, 0x77}, {0x60, 0xFF}, {0xB9, 0xC0}, {0xFE, 0xEB}};
+        for (const auto &pair : pairs)
+        {
+            table[pair[0]] = pair[1];
+            table[pair[1]] = pair[0];
+        }
+        return table;
+    }
+
+    static constexpr std::array<uint8_t, 256> SHUFFLE_SUBSTITUTION = MakeShuffleSubstitution();
+
+    static void ShuffleDecode(uint8_t *block)
+    {
+        uint8_t out[8] = {
+            block[3], block[4], block[6], block[0],
+            block[1], block[2], block[5], SHUFFLE_SUBSTITUTION[block[7]]};
+
+        for (int i = 0; i < 8; i++)
+        {
+            block[i] = out[i];
+        }
+    }
+
+    void GrfDecodeEntry(uint8_t *data, size_t size, uint8_t flags, uint32_t cycle)
+    {
+        size_t blockCount = size / 8;
+
+        if (!(flags & (FLAG_MIXCRYPT | FLAG_DES)))
+        {
+            return;
+        }
+
+        // Os 20 primeiros blocos são sempre encriptados
+        size_t i = 0;
+        for (; i < 20 && i < blockCount; i++)
+        {
+            GrfDesDecryptBlock(data + i * 8);
+        }
+
+        if (!(flags & FLAG_MIXCRYPT))
+        {
+            return; // Apenas o cabeçalho
+        }
+
+        // Depois: um bloco a cada 'cycle' é encriptado e, entre os demais,
+        // um a cada 7 (sem contar o primeiro) é embaralhado
+        if (cycle == 0)
+        {
+            cycle = 1;
+        }
+
+        size_t plainIndex = 0;
+        for (; i < blockCount; i++)
+        {
+            if (i % cycle == 0)
+            {
+                GrfDesDecryptBlock(data + i * 8);
+                continue;
+            }
+
+            if (plainIndex % 7 == 0 && plainIndex != 0)
+            {
+                ShuffleDecode(data + i * 8);
+            }
+            plainIndex++;
+        }
+    }
+
+    void GrfDecodeLegacyName(uint8_t *name, size_t size)
+    {
+        for (size_t i = 0; i + 8 <= size; i += 8)
+        {
+            for (size_t j = 0; j < 8; j++)
+            {
+                name[i + j] = static_cast<uint8_t>((name[i + j] >> 4) | (name[i + j] << 4));
+            }
+            GrfDesDecryptBlock(name + i);
+        }
+    }
+
+} // namespace autopatch
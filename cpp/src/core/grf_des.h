@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace autopatch
+{
+
+    // DES do GRF: variante de uma única rodada, sem chave, usada pelo cliente do jogo
+    // (IP -> rodada -> FP). Tabelas de permutação e SP-boxes são geradas em tempo de compilação.
+
+    // Decripta um bloco de 8 bytes no lugar
+    void GrfDesDecryptBlock(uint8_t *block);
+
+    // Intervalo entre blocos encriptados no modo misto, derivado do número
+    // de dígitos do tamanho comprimido da entrada
+    uint32_t GrfDesCycle(uint32_t compressedSize);
+
+    // Decripta os dados de uma entrada (tamanho alinhado a 8 bytes):
+    // - GRFFILE_FLAG_MIXCRYPT: 20 primeiros blocos + um a cada 'cycle', com embaralhamento dos demais
+    // - GRFFILE_FLAG_DES: apenas os 20 primeiros blocos
+    void GrfDecodeEntry(uint8_t *data, size_t size, uint8_t flags, uint32_t cycle);
+
+    // Decodifica um nome de arquivo da tabela de GRFs 0x1xx (nibble swap + DES por bloco)
+    void GrfDecodeLegacyName(uint8_t *name, size_t size);
+
+} // namespace autopatch
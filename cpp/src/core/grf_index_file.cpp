@@ -0,0 +1,228 @@
+#include "grf_index_file.h"
+#include "file_io.h"
+#include <cstring>
+#include <filesystem>
+
+namespace autopatch
+{
+
+    static constexpr char INDEX_MAGIC[8] = {'A', 'P', 'G', 'R', 'F', 'I', 'D', 'X'};
+    static constexpr uint32_t INDEX_LAYOUT_VERSION = 3; // 3: hash sem normalizar o segundo byte de caracteres CP949
+
+    struct GrfIndexFileHeader
+    {
+        char magic[8];
+        uint32_t layoutVersion;
+        uint32_t grfVersion;
+        uint64_t grfSize;
+        uint64_t grfMtime;
+        uint64_t tableOffset;
+        uint64_t tableSize;
+        uint32_t fileCount;
+        uint32_t entryCount;
+        uint32_t slotCount;
+        uint32_t chunkCount;
+    };
+    static_assert(sizeof(GrfIndexFileHeader) == 64, "Header do .idx tem 64 bytes");
+
+    static inline uint64_t Align8(uint64_t value)
+    {
+        return (value + 7) & ~7ull;
+    }
+
+    bool GrfIndexFileStat(const std::wstring &path, uint64_t &size, uint64_t &mtime)
+    {
+        std::error_code ec;
+        std::filesystem::path file(path);
+        size = std::filesystem::file_size(file, ec);
+        if (ec)
+        {
+            return false;
+        }
+        auto time = std::filesystem::last_write_time(file, ec);
+        if (ec)
+        {
+            return false;
+        }
+        mtime = static_cast<uint64_t>(time.time_since_epoch().count());
+        return true;
+    }
+
+    bool LoadGrfIndexFile(const std::wstring &path, const GrfIndexKey &key, uint64_t &tableSize,
+                          GrfNameIndex &index, GrfFileTable &table)
+    {
+        MappedFile mapped;
+        if (!mapped.Open(path) || mapped.Size() < sizeof(GrfIndexFileHeader))
+        {
+            return false;
+        }
+
+        GrfIndexFileHeader header;
+        memcpy(&header, mapped.Data(), sizeof(header));
+        if (memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+            header.layoutVersion != INDEX_LAYOUT_VERSION ||
+            header.grfVersion != key.grfVersion ||
+            header.grfSize != key.grfSize ||
+            header.grfMtime != key.grfMtime ||
+            header.tableOffset != key.tableOffset ||
+            header.fileCount != key.fileCount ||
+            header.tableSize < 8)
+        {
+            return false;
+        }
+
+        // Seções na ordem de gravação (vazias não são alinhadas); nulo se ultrapassar o arquivo
+        uint64_t pos = sizeof(header);
+        auto take = [&](uint64_t bytes) -> const uint8_t *
+        {
+            if (bytes == 0)
+            {
+                return mapped.Data() + pos;
+            }
+            pos = Align8(pos);
+            if (bytes > mapped.Size() || pos > mapped.Size() - bytes)
+            {
+                return nullptr;
+            }
+            const uint8_t *data = mapped.Data() + pos;
+            pos += bytes;
+            return data;
+        };
+
+        uint64_t count = header.entryCount;
+        const uint8_t *offsets = take(count * sizeof(uint64_t));
+        const uint8_t *compressedSize = take(count * sizeof(uint32_t));
+        const uint8_t *compressedSizeAligned = take(count * sizeof(uint32_t));
+        const uint8_t *uncompressedSize = take(count * sizeof(uint32_t));
+        const uint8_t *hashes = take(count * sizeof(uint32_t));
+        const uint8_t *nameOffsets = take(count * sizeof(uint32_t));
+        const uint8_t *nameLengths = take(count * sizeof(uint16_t));
+        const uint8_t *flags = take(count);
+        const uint8_t *slots = take(uint64_t(header.slotCount) * 8);
+        const uint8_t *chunkSizes = take(uint64_t(header.chunkCount) * sizeof(uint32_t));
+        if (!offsets || !compressedSize || !compressedSizeAligned || !uncompressedSize || !hashes ||
+            !nameOffsets || !nameLengths || !flags || !slots || !chunkSizes)
+        {
+            return false;
+        }
+
+        GrfNameIndex::Image image;
+        image.nameOffsets = {reinterpret_cast<const uint32_t *>(nameOffsets), count};
+        image.nameLengths = {reinterpret_cast<const uint16_t *>(nameLengths), count};
+        image.hashes = {reinterpret_cast<const uint32_t *>(hashes), count};
+        image.slots = {slots, uint64_t(header.slotCount) * 8};
+
+        for (uint32_t i = 0; i < header.chunkCount; i++)
+        {
+            uint32_t size;
+            memcpy(&size, chunkSizes + i * sizeof(uint32_t), sizeof(size));
+            const uint8_t *chunk = take(size);
+            if (!chunk)
+            {
+                return false;
+            }
+            image.chunks.emplace_back(reinterpret_cast<const char *>(chunk), size);
+        }
+
+        if (pos != mapped.Size() || !index.Import(image))
+        {
+            return false;
+        }
+
+        auto column = [count](auto &dst, const uint8_t *src)
+        {
+            dst.resize(count);
+            memcpy(dst.data(), src, count * sizeof(dst[0]));
+        };
+
+        table.Clear();
+        column(table.offset, offsets);
+        column(table.compressedSize, compressedSize);
+        column(table.compressedSizeAligned, compressedSizeAligned);
+        column(table.uncompressedSize, uncompressedSize);
+        column(table.flags, flags);
+        tableSize = header.tableSize;
+        return true;
+    }
+
+    bool SaveGrfIndexFile(const std::wstring &path, const GrfIndexKey &key, uint64_t tableSize,
+                          const GrfNameIndex &index, const GrfFileTable &table)
+    {
+        GrfNameIndex::Image image = index.Export();
+        if (image.hashes.size() != table.Size())
+        {
+            return false;
+        }
+
+        GrfIndexFileHeader header = {};
+        memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        header.layoutVersion = INDEX_LAYOUT_VERSION;
+        header.grfVersion = key.grfVersion;
+        header.grfSize = key.grfSize;
+        header.grfMtime = key.grfMtime;
+        header.tableOffset = key.tableOffset;
+        header.tableSize = tableSize;
+        header.fileCount = key.fileCount;
+        header.entryCount = static_cast<uint32_t>(table.Size());
+        header.slotCount = static_cast<uint32_t>(image.slots.size() / 8);
+        header.chunkCount = static_cast<uint32_t>(image.chunks.size());
+
+        std::vector<uint32_t> chunkSizes;
+        for (const auto &chunk : image.chunks)
+        {
+            chunkSizes.push_back(static_cast<uint32_t>(chunk.size()));
+        }
+
+        std::wstring tempPath = path + L".tmp";
+        File file;
+        if (!file.Create(tempPath))
+        {
+            return false;
+        }
+
+        // Mesma ordem e alinhamento de LoadGrfIndexFile
+        uint64_t pos = 0;
+        bool ok = true;
+        auto put = [&](const void *data, size_t bytes)
+        {
+            if (bytes == 0)
+            {
+                return;
+            }
+            pos = Align8(pos);
+            ok = ok && file.WriteAt(pos, data, bytes);
+            pos += bytes;
+        };
+
+        put(&header, sizeof(header));
+        put(table.offset.data(), table.offset.size() * sizeof(uint64_t));
+        put(table.compressedSize.data(), table.compressedSize.size() * sizeof(uint32_t));
+        put(table.compressedSizeAligned.data(), table.compressedSizeAligned.size() * sizeof(uint32_t));
+        put(table.uncompressedSize.data(), table.uncompressedSize.size() * sizeof(uint32_t));
+        put(image.hashes.data(), image.hashes.size_bytes());
+        put(image.nameOffsets.data(), image.nameOffsets.size_bytes());
+        put(image.nameLengths.data(), image.nameLengths.size_bytes());
+        put(table.flags.data(), table.flags.size());
+        put(image.slots.data(), image.slots.size());
+        put(chunkSizes.data(), chunkSizes.size() * sizeof(uint32_t));
+        for (const auto &chunk : image.chunks)
+        {
+            put(chunk.data(), chunk.size());
+        }
+
+        file.Close();
+
+        std::error_code ec;
+        if (ok)
+        {
+            std::filesystem::rename(std::filesystem::path(tempPath), std::filesystem::path(path), ec);
+        }
+        if (!ok || ec)
+        {
+            std::filesystem::remove(std::filesystem::path(tempPath), ec);
+            return false;
+        }
+        return true;
+    }
+
+} // namespace autopatch
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include "grf_table.h"
+
+namespace autopatch
+{
+
+    // Estado do GRF ao qual um índice persistido corresponde, obtido só do header e do
+    // sistema de arquivos (a tabela não é lida). Qualquer diferença (arquivo regravado,
+    // tabela movida, outra contagem) invalida o índice.
+    struct GrfIndexKey
+    {
+        uint32_t grfVersion = 0;
+        uint64_t grfSize = 0;
+        uint64_t grfMtime = 0;    // Data de modificação (unidades do relógio do sistema de arquivos)
+        uint64_t tableOffset = 0; // Relativo ao fim do header
+        uint32_t fileCount = 0;   // Contagem de entradas do header
+    };
+
+    /**
+     * Índice persistido (.idx ao lado do GRF)
+     *
+     * Guarda a tabela de arquivos já parseada (colunas do GrfFileTable, colunas e slots do
+     * GrfNameIndex e a arena de nomes) num layout binário little-endian: header de 64 bytes
+     * seguido das seções, cada uma alinhada a 8 bytes. A abertura mapeia o arquivo e copia
+     * cada seção em bloco (memcpy por coluna; a tabela continua mutável para o patch), sem
+     * ler, descomprimir nem parsear a tabela do GRF.
+     */
+
+    // Tamanho e data de modificação de um arquivo
+    bool GrfIndexFileStat(const std::wstring &path, uint64_t &size, uint64_t &mtime);
+
+    // Carrega o índice de 'path' se existir, for válido e corresponder a 'key'. 'tableSize'
+    // recebe o tamanho da região da tabela no GRF (8 bytes de tamanhos + dados comprimidos).
+    bool LoadGrfIndexFile(const std::wstring &path, const GrfIndexKey &key, uint64_t &tableSize,
+                          GrfNameIndex &index, GrfFileTable &table);
+
+    // Grava o índice em 'path' (via arquivo temporário + rename: nunca fica um .idx pela metade)
+    bool SaveGrfIndexFile(const std::wstring &path, const GrfIndexKey &key, uint64_t tableSize,
+                          const GrfNameIndex &index, const GrfFileTable &table);
+
+} // namespace autopatch
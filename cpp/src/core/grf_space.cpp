@@ -0,0 +1,179 @@
+#include "grf_space.h"
+#include <algorithm>
+
+namespace autopatch
+{
+
+    static inline uint64_t AlignUp(uint64_t value)
+    {
+        return (value + GrfSpaceAllocator::ALIGNMENT - 1) & ~(GrfSpaceAllocator::ALIGNMENT - 1);
+    }
+
+    void GrfSpaceAllocator::Reset(uint64_t end)
+    {
+        m_holes.clear();
+        m_bySize.clear();
+        m_end = end;
+        m_freeBytes = 0;
+    }
+
+    void GrfSpaceAllocator::Build(std::vector<std::pair<uint64_t, uint64_t>> used)
+    {
+        Reset();
+
+        std::sort(used.begin(), used.end());
+
+        uint64_t cursor = 0;
+        for (const auto &[offset, size] : used)
+        {
+            if (size == 0)
+            {
+                continue;
+            }
+            if (offset > cursor)
+            {
+                AddHole(cursor, offset - cursor);
+            }
+            cursor = std::max(cursor, offset + size);
+        }
+
+        m_end = cursor;
+    }
+
+    uint64_t GrfSpaceAllocator::Allocate(uint64_t size)
+    {
+        // Best-fit: menor buraco onde o bloco alinhado cabe
+        for (auto it = m_bySize.lower_bound({size, 0}); it != m_bySize.end(); ++it)
+        {
+            uint64_t holeOffset = it->second;
+            uint64_t holeEnd = holeOffset + it->first;
+            uint64_t start = AlignUp(holeOffset);
+            if (start + size > holeEnd)
+            {
+                continue;
+            }
+
+            return TakeFromHole(m_holes.find(holeOffset), start, size);
+        }
+
+        // Nenhum buraco serve: cresce a área de dados
+        return AllocateAtEnd(size);
+    }
+
+    uint64_t GrfSpaceAllocator::AllocateAtEnd(uint64_t size)
+    {
+        uint64_t start = AlignUp(m_end);
+        if (start > m_end)
+        {
+            AddHole(m_end, start - m_end);
+        }
+        m_end = start + size;
+        return start;
+    }
+
+    uint64_t GrfSpaceAllocator::FindLowest(uint64_t size, uint64_t limit) const
+    {
+        if (size > LargestHole())
+        {
+            return npos;
+        }
+
+        for (auto it = m_holes.begin(); it != m_holes.end() && it->first < limit; ++it)
+        {
+            uint64_t holeEnd = it->first + it->second;
+            uint64_t start = AlignUp(it->first);
+            if (start + size <= holeEnd && start + size <= limit)
+            {
+                return start;
+            }
+        }
+
+        return npos;
+    }
+
+    uint64_t GrfSpaceAllocator::AllocateLowest(uint64_t size, uint64_t limit)
+    {
+        uint64_t start = FindLowest(size, limit);
+        if (start == npos)
+        {
+            return npos;
+        }
+
+        // O buraco que contém 'start' é o último com offset <= start
+        auto it = std::prev(m_holes.upper_bound(start));
+        return TakeFromHole(it, start, size);
+    }
+
+    void GrfSpaceAllocator::Free(uint64_t offset, uint64_t size)
+    {
+        if (size == 0)
+        {
+            return;
+        }
+
+        uint64_t end = offset + size;
+
+        // Une com o buraco seguinte
+        auto next = m_holes.lower_bound(offset);
+        if (next != m_holes.end() && next->first <= end)
+        {
+            end = std::max(end, next->first + next->second);
+            RemoveHole(next);
+        }
+
+        // Une com o buraco anterior
+        auto prev = m_holes.lower_bound(offset);
+        if (prev != m_holes.begin())
+        {
+            --prev;
+            if (prev->first + prev->second >= offset)
+            {
+                offset = prev->first;
+                end = std::max(end, prev->first + prev->second);
+                RemoveHole(prev);
+            }
+        }
+
+        // Buraco no fim da área de dados: encolhe em vez de guardar
+        if (end >= m_end)
+        {
+            m_end = offset;
+            return;
+        }
+
+        AddHole(offset, end - offset);
+    }
+
+    uint64_t GrfSpaceAllocator::TakeFromHole(std::map<uint64_t, uint64_t>::iterator it, uint64_t start, uint64_t size)
+    {
+        // Sobras antes (alinhamento) e depois do bloco continuam como buracos
+        uint64_t holeOffset = it->first;
+        uint64_t holeEnd = holeOffset + it->second;
+
+        RemoveHole(it);
+        if (start > holeOffset)
+        {
+            AddHole(holeOffset, start - holeOffset);
+        }
+        if (start + size < holeEnd)
+        {
+            AddHole(start + size, holeEnd - (start + size));
+        }
+        return start;
+    }
+
+    void GrfSpaceAllocator::AddHole(uint64_t offset, uint64_t size)
+    {
+        m_holes.emplace(offset, size);
+        m_bySize.emplace(size, offset);
+        m_freeBytes += size;
+    }
+
+    void GrfSpaceAllocator::RemoveHole(std::map<uint64_t, uint64_t>::iterator it)
+    {
+        m_bySize.erase({it->second, it->first});
+        m_freeBytes -= it->second;
+        m_holes.erase(it);
+    }
+
+} // namespace autopatch
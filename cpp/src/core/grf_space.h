@@ -0,0 +1,66 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace autopatch
+{
+
+    // Alocador best-fit do espaço de dados de um GRF.
+    // Offsets são relativos ao fim do header (como na tabela de arquivos).
+    // Mantém a lista de buracos (regiões sem dono) e o fim da área de dados;
+    // alocações que não cabem em nenhum buraco crescem o arquivo.
+    class GrfSpaceAllocator
+    {
+    public:
+        static constexpr uint64_t ALIGNMENT = 8;
+        static constexpr uint64_t npos = ~0ull;
+
+        // Sem buracos, área de dados termina em 'end'
+        void Reset(uint64_t end = 0);
+
+        // Reconstrói a partir das regiões em uso {offset, tamanho}.
+        // Regiões sobrepostas são aceitas; os buracos são os intervalos não cobertos.
+        void Build(std::vector<std::pair<uint64_t, uint64_t>> used);
+
+        // Aloca 'size' bytes com início alinhado em ALIGNMENT; usa o menor buraco
+        // que comporta o tamanho ou, se nenhum servir, o fim da área de dados
+        uint64_t Allocate(uint64_t size);
+
+        // Aloca no fim da área de dados (início alinhado), ignorando os buracos.
+        // Usado por dados gravados em stream, cujo tamanho só é conhecido no final.
+        uint64_t AllocateAtEnd(uint64_t size);
+
+        // Aloca no buraco de menor offset onde o bloco alinhado cabe inteiro abaixo de 'limit'
+        // (usado pela compactação para descer dados); npos se nenhum servir
+        uint64_t AllocateLowest(uint64_t size, uint64_t limit = npos);
+
+        // Onde AllocateLowest alocaria, sem alocar; npos se nenhum buraco servir
+        uint64_t FindLowest(uint64_t size, uint64_t limit = npos) const;
+
+        // Devolve uma região; buracos vizinhos são unidos e um buraco no fim encolhe a área
+        void Free(uint64_t offset, uint64_t size);
+
+        // Fim da área de dados (maior offset em uso)
+        uint64_t End() const { return m_end; }
+
+        uint64_t FreeBytes() const { return m_freeBytes; }
+        size_t HoleCount() const { return m_holes.size(); }
+        uint64_t LargestHole() const { return m_bySize.empty() ? 0 : m_bySize.rbegin()->first; }
+
+    private:
+        uint64_t TakeFromHole(std::map<uint64_t, uint64_t>::iterator it, uint64_t start, uint64_t size);
+        void AddHole(uint64_t offset, uint64_t size);
+        void RemoveHole(std::map<uint64_t, uint64_t>::iterator it);
+
+        std::map<uint64_t, uint64_t> m_holes;            // offset -> tamanho
+        std::set<std::pair<uint64_t, uint64_t>> m_bySize; // {tamanho, offset}
+        uint64_t m_end = 0;
+        uint64_t m_freeBytes = 0;
+    };
+
+} // namespace autopatch
@@ -0,0 +1,624 @@
+#include "grf_table.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <Windows.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#define GRF_PREFETCH(p) _mm_prefetch(reinterpret_cast<const char *>(p), _MM_HINT_T0)
+#else
+#define GRF_PREFETCH(p) ((void)0)
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GRF_HAS_SSE2 1
+#endif
+
+namespace autopatch
+{
+
+    static inline uint8_t NormalizeNameChar(uint8_t c)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            return c + ('a' - 'A');
+        }
+        if (c == '/')
+        {
+            return '\\';
+        }
+        return c;
+    }
+
+    // Primeiro byte de um caractere de dois bytes em CP949 (UHC). O segundo byte pode cair
+    // em 'A'-'Z'/'a'-'z' sem ser letra: só caracteres de um byte passam pela normalização.
+    static inline bool IsLeadByte(uint8_t c)
+    {
+        return c >= 0x81 && c <= 0xFE;
+    }
+
+    uint32_t GrfNameHash(std::string_view name)
+    {
+        // FNV-1a 32 bits
+        uint32_t hash = 2166136261u;
+        bool trail = false;
+        for (char ch : name)
+        {
+            uint8_t c = static_cast<uint8_t>(ch);
+            hash ^= trail ? c : NormalizeNameChar(c);
+            hash *= 16777619u;
+            trail = !trail && IsLeadByte(c);
+        }
+        return hash;
+    }
+
+    bool GrfNameEquals(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+
+        // Bytes iniciais não mudam com a normalização: iguais até aqui, a posição de
+        // segundo byte é a mesma nos dois nomes
+        bool trail = false;
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            uint8_t ca = static_cast<uint8_t>(a[i]);
+            uint8_t cb = static_cast<uint8_t>(b[i]);
+            if (trail ? ca != cb : NormalizeNameChar(ca) != NormalizeNameChar(cb))
+            {
+                return false;
+            }
+            trail = !trail && IsLeadByte(ca);
+        }
+        return true;
+    }
+
+    int GrfNameCompare(std::string_view a, std::string_view b)
+    {
+        size_t n = std::min(a.size(), b.size());
+        bool trail = false;
+        for (size_t i = 0; i < n; i++)
+        {
+            uint8_t ca = static_cast<uint8_t>(a[i]);
+            uint8_t cb = static_cast<uint8_t>(b[i]);
+            bool lead = !trail && IsLeadByte(ca);
+            if (!trail)
+            {
+                ca = NormalizeNameChar(ca);
+                cb = NormalizeNameChar(cb);
+            }
+            if (ca != cb)
+            {
+                return ca < cb ? -1 : 1;
+            }
+            trail = lead;
+        }
+        return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+    }
+
+    bool GrfNameStartsWith(std::string_view name, std::string_view prefix)
+    {
+        return name.size() >= prefix.size() && GrfNameEquals(name.substr(0, prefix.size()), prefix);
+    }
+
+    bool GrfNameMatch(std::string_view name, std::string_view pattern)
+    {
+        // Casamento guloso com retrocesso para o último '*' (linear na prática).
+        // 'trail': name[n] é o segundo byte de um caractere CP949 (comparado sem normalizar)
+        size_t n = 0, p = 0;
+        size_t starPattern = std::string_view::npos, starName = 0;
+        bool trail = false, starTrail = false;
+        while (n < name.size())
+        {
+            uint8_t c = static_cast<uint8_t>(name[n]);
+            if (p < pattern.size() && pattern[p] == '*')
+            {
+                starPattern = p++;
+                starName = n;
+                starTrail = trail;
+            }
+            else if (p < pattern.size() &&
+                     (pattern[p] == '?' || (trail ? static_cast<uint8_t>(pattern[p]) == c
+                                                  : NormalizeNameChar(static_cast<uint8_t>(pattern[p])) == NormalizeNameChar(c))))
+            {
+                p++;
+                n++;
+                trail = !trail && IsLeadByte(c);
+            }
+            else if (starPattern != std::string_view::npos)
+            {
+                // '*' absorve mais um byte do nome
+                starTrail = !starTrail && IsLeadByte(static_cast<uint8_t>(name[starName]));
+                p = starPattern + 1;
+                n = ++starName;
+                trail = starTrail;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        while (p < pattern.size() && pattern[p] == '*')
+        {
+            p++;
+        }
+        return p == pattern.size();
+    }
+
+    bool GrfNameToPath(std::string_view name, std::filesystem::path &path)
+    {
+        std::wstring wide;
+        if (!name.empty())
+        {
+            int size = MultiByteToWideChar(949, 0, name.data(), static_cast<int>(name.size()), nullptr, 0);
+            if (size <= 0)
+            {
+                // Sem conversão disponível: byte a byte
+                wide.assign(name.begin(), name.end());
+            }
+            else
+            {
+                wide.resize(size);
+                MultiByteToWideChar(949, 0, name.data(), static_cast<int>(name.size()), wide.data(), size);
+            }
+        }
+
+        std::replace(wide.begin(), wide.end(), L'\\', static_cast<wchar_t>(std::filesystem::path::preferred_separator));
+        std::replace(wide.begin(), wide.end(), L'/', static_cast<wchar_t>(std::filesystem::path::preferred_separator));
+
+        // Só caminhos que ficam dentro do destino: sem raiz, drive ('C:', ADS) nem '..'
+        std::filesystem::path result(wide);
+        if (result.empty() || result.has_root_path())
+        {
+            return false;
+        }
+        for (const auto &part : result)
+        {
+            if (part == L".." || part.wstring().find(L':') != std::wstring::npos)
+            {
+                return false;
+            }
+        }
+
+        path = std::move(result);
+        return true;
+    }
+
+    void GrfNameIndex::Clear()
+    {
+        m_chunks.clear();
+        m_chunkUsed = ARENA_CHUNK_SIZE;
+        m_nameOffsets.clear();
+        m_nameLengths.clear();
+        m_hashes.clear();
+        m_slots.clear();
+    }
+
+    void GrfNameIndex::Reserve(size_t count)
+    {
+        m_nameOffsets.reserve(count);
+        m_nameLengths.reserve(count);
+        m_hashes.reserve(count);
+
+        // Fator de carga máximo de 75%
+        size_t slotCount = 16;
+        while (slotCount * 3 < count * 4)
+        {
+            slotCount <<= 1;
+        }
+        if (slotCount > m_slots.size())
+        {
+            Rehash(slotCount);
+        }
+    }
+
+    uint32_t GrfNameIndex::Probe(std::string_view name, uint32_t hash) const
+    {
+        if (m_slots.empty())
+        {
+            return npos;
+        }
+
+        size_t mask = m_slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            const Slot &slot = m_slots[i];
+            if (slot.row == npos)
+            {
+                return npos;
+            }
+            if (slot.hash == hash && GrfNameEquals(Name(slot.row), name))
+            {
+                return slot.row;
+            }
+        }
+    }
+
+    uint32_t GrfNameIndex::Find(std::string_view name) const
+    {
+        return Probe(name, GrfNameHash(name));
+    }
+
+    void GrfNameIndex::FindMany(const std::string_view *names, size_t count, uint32_t *rows) const
+    {
+        if (m_slots.empty())
+        {
+            std::fill(rows, rows + count, npos);
+            return;
+        }
+
+        // Processa em lotes: calcula os hashes e dispara prefetch dos slots
+        // antes de sondar, para sobrepor as faltas de cache
+        constexpr size_t BATCH = 16;
+        uint32_t hashes[BATCH];
+        size_t mask = m_slots.size() - 1;
+
+        for (size_t base = 0; base < count; base += BATCH)
+        {
+            size_t n = std::min(BATCH, count - base);
+
+            for (size_t i = 0; i < n; i++)
+            {
+                hashes[i] = GrfNameHash(names[base + i]);
+                GRF_PREFETCH(&m_slots[hashes[i] & mask]);
+            }
+
+            for (size_t i = 0; i < n; i++)
+            {
+                rows[base + i] = Probe(names[base + i], hashes[i]);
+            }
+        }
+    }
+
+    uint32_t GrfNameIndex::Insert(std::string_view name)
+    {
+        return InsertHashed(name, GrfNameHash(name));
+    }
+
+    uint32_t GrfNameIndex::FindOrInsert(std::string_view name, bool &inserted)
+    {
+        uint32_t hash = GrfNameHash(name);
+        uint32_t row = Probe(name, hash);
+        inserted = row == npos;
+        return inserted ? InsertHashed(name, hash) : row;
+    }
+
+    void GrfNameIndex::FindOrInsertMany(const std::string_view *names, size_t count, uint32_t *rows, bool *inserted)
+    {
+        constexpr size_t BATCH = 16;
+        uint32_t hashes[BATCH];
+
+        for (size_t base = 0; base < count; base += BATCH)
+        {
+            size_t n = std::min(BATCH, count - base);
+
+            for (size_t i = 0; i < n; i++)
+            {
+                hashes[i] = GrfNameHash(names[base + i]);
+                if (!m_slots.empty())
+                {
+                    GRF_PREFETCH(&m_slots[hashes[i] & (m_slots.size() - 1)]);
+                }
+            }
+
+            // Inserções podem redimensionar m_slots: a máscara é relida a cada nome
+            for (size_t i = 0; i < n; i++)
+            {
+                uint32_t row = Probe(names[base + i], hashes[i]);
+                inserted[base + i] = row == npos;
+                rows[base + i] = row == npos ? InsertHashed(names[base + i], hashes[i]) : row;
+            }
+        }
+    }
+
+    uint32_t GrfNameIndex::InsertHashed(std::string_view name, uint32_t hash)
+    {
+        if (name.size() > 0xFFFF)
+        {
+            return npos;
+        }
+
+        uint32_t row = static_cast<uint32_t>(m_hashes.size());
+
+        uint32_t offset = AppendName(name);
+
+        m_nameOffsets.push_back(offset);
+        m_nameLengths.push_back(static_cast<uint16_t>(name.size()));
+        m_hashes.push_back(hash);
+
+        if (m_hashes.size() * 4 > m_slots.size() * 3)
+        {
+            Rehash(m_slots.empty() ? 16 : m_slots.size() * 2);
+        }
+        else
+        {
+            size_t mask = m_slots.size() - 1;
+            size_t i = hash & mask;
+            while (m_slots[i].row != npos)
+            {
+                i = (i + 1) & mask;
+            }
+            m_slots[i] = {hash, row};
+        }
+
+        return row;
+    }
+
+    std::string_view GrfNameIndex::Name(uint32_t row) const
+    {
+        uint32_t offset = m_nameOffsets[row];
+        const char *chunk = m_chunks[offset / ARENA_CHUNK_SIZE].get();
+        return {chunk + offset % ARENA_CHUNK_SIZE, m_nameLengths[row]};
+    }
+
+    uint32_t GrfNameIndex::AppendName(std::string_view name)
+    {
+        // Nome + terminador nulo (permite uso como C string)
+        size_t needed = name.size() + 1;
+        if (m_chunkUsed + needed > ARENA_CHUNK_SIZE)
+        {
+            m_chunks.push_back(std::make_unique<char[]>(ARENA_CHUNK_SIZE));
+            m_chunkUsed = 0;
+        }
+
+        char *dst = m_chunks.back().get() + m_chunkUsed;
+        memcpy(dst, name.data(), name.size());
+        dst[name.size()] = '\0';
+
+        uint32_t offset = static_cast<uint32_t>((m_chunks.size() - 1) * ARENA_CHUNK_SIZE + m_chunkUsed);
+        m_chunkUsed += needed;
+        return offset;
+    }
+
+    void GrfNameIndex::Rehash(size_t slotCount)
+    {
+        m_slots.assign(slotCount, Slot{});
+
+        size_t mask = slotCount - 1;
+        for (uint32_t row = 0; row < m_hashes.size(); row++)
+        {
+            size_t i = m_hashes[row] & mask;
+            while (m_slots[i].row != npos)
+            {
+                i = (i + 1) & mask;
+            }
+            m_slots[i] = {m_hashes[row], row};
+        }
+    }
+
+    size_t GrfNameIndex::IndexMemoryUsage() const
+    {
+        return m_slots.capacity() * sizeof(Slot) +
+               m_nameOffsets.capacity() * sizeof(uint32_t) +
+               m_nameLengths.capacity() * sizeof(uint16_t) +
+               m_hashes.capacity() * sizeof(uint32_t);
+    }
+
+    size_t GrfNameIndex::NameMemoryUsage() const
+    {
+        return m_chunks.size() * ARENA_CHUNK_SIZE;
+    }
+
+    GrfNameIndex::Image GrfNameIndex::Export() const
+    {
+        static_assert(sizeof(Slot) == 8, "Slot é gravado como {hash, linha}");
+
+        Image image;
+        image.nameOffsets = m_nameOffsets;
+        image.nameLengths = m_nameLengths;
+        image.hashes = m_hashes;
+        image.slots = {reinterpret_cast<const uint8_t *>(m_slots.data()), m_slots.size() * sizeof(Slot)};
+
+        for (size_t i = 0; i < m_chunks.size(); i++)
+        {
+            size_t used = i + 1 == m_chunks.size() ? m_chunkUsed : ARENA_CHUNK_SIZE;
+            image.chunks.emplace_back(m_chunks[i].get(), used);
+        }
+        return image;
+    }
+
+    bool GrfNameIndex::Import(const Image &image)
+    {
+        Clear();
+
+        size_t count = image.hashes.size();
+        size_t slotCount = image.slots.size() / sizeof(Slot);
+        if (image.nameOffsets.size() != count || image.nameLengths.size() != count ||
+            image.slots.size() % sizeof(Slot) != 0)
+        {
+            return false;
+        }
+
+        // Potência de 2 com pelo menos um slot vazio (a sondagem precisa terminar)
+        if (count > 0 && (slotCount <= count || (slotCount & (slotCount - 1)) != 0))
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < image.chunks.size(); i++)
+        {
+            if (image.chunks[i].size() > ARENA_CHUNK_SIZE)
+            {
+                return false;
+            }
+        }
+
+        // Cada nome (com terminador) precisa estar dentro do seu bloco
+        for (size_t row = 0; row < count; row++)
+        {
+            size_t chunk = image.nameOffsets[row] / ARENA_CHUNK_SIZE;
+            size_t pos = image.nameOffsets[row] % ARENA_CHUNK_SIZE;
+            if (chunk >= image.chunks.size() || pos + image.nameLengths[row] + 1 > image.chunks[chunk].size())
+            {
+                return false;
+            }
+        }
+
+        m_slots.resize(slotCount);
+        if (slotCount > 0)
+        {
+            memcpy(m_slots.data(), image.slots.data(), image.slots.size());
+        }
+        for (const Slot &slot : m_slots)
+        {
+            if (slot.row != npos && slot.row >= count)
+            {
+                m_slots.clear();
+                return false;
+            }
+        }
+
+        m_nameOffsets.assign(image.nameOffsets.begin(), image.nameOffsets.end());
+        m_nameLengths.assign(image.nameLengths.begin(), image.nameLengths.end());
+        m_hashes.assign(image.hashes.begin(), image.hashes.end());
+
+        for (const auto &chunk : image.chunks)
+        {
+            m_chunks.push_back(std::make_unique<char[]>(ARENA_CHUNK_SIZE));
+            memcpy(m_chunks.back().get(), chunk.data(), chunk.size());
+        }
+        m_chunkUsed = m_chunks.empty() ? ARENA_CHUNK_SIZE : image.chunks.back().size();
+        return true;
+    }
+
+    void GrfFileTable::Clear()
+    {
+        compressedSize.clear();
+        compressedSizeAligned.clear();
+        uncompressedSize.clear();
+        offset.clear();
+        flags.clear();
+    }
+
+    void GrfFileTable::Reserve(size_t count)
+    {
+        compressedSize.reserve(count);
+        compressedSizeAligned.reserve(count);
+        uncompressedSize.reserve(count);
+        offset.reserve(count);
+        flags.reserve(count);
+    }
+
+    uint32_t GrfFileTable::Append()
+    {
+        uint32_t row = static_cast<uint32_t>(flags.size());
+        compressedSize.push_back(0);
+        compressedSizeAligned.push_back(0);
+        uncompressedSize.push_back(0);
+        offset.push_back(0);
+        flags.push_back(0);
+        return row;
+    }
+
+    size_t GrfFileTable::MemoryUsage() const
+    {
+        return compressedSize.capacity() * sizeof(uint32_t) +
+               compressedSizeAligned.capacity() * sizeof(uint32_t) +
+               uncompressedSize.capacity() * sizeof(uint32_t) +
+               offset.capacity() * sizeof(uint64_t) +
+               flags.capacity() * sizeof(uint8_t);
+    }
+
+    // Primeiro byte nulo em [p, end), ou end se não houver
+    static inline const uint8_t *FindTerminator(const uint8_t *p, const uint8_t *end)
+    {
+#ifdef GRF_HAS_SSE2
+        // 16 bytes por comparação; a cauda (< 16 bytes) fica para o laço escalar
+        const __m128i zero = _mm_setzero_si128();
+        while (end - p >= 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero)));
+            if (mask != 0)
+            {
+                return p + std::countr_zero(mask);
+            }
+            p += 16;
+        }
+#endif
+        while (p < end && *p != 0)
+        {
+            p++;
+        }
+        return p;
+    }
+
+    // Laço especializado pelo tamanho do offset (4 em 0x200, 8 em 0x300): sem teste de versão por entrada.
+    // Os nomes são localizados em lotes e inseridos com FindOrInsertMany, que sobrepõe as
+    // faltas de cache nos slots do índice.
+    template <size_t OffsetSize>
+    static bool ParseEntries(const uint8_t *data, size_t size, uint32_t count, GrfNameIndex &index, GrfFileTable &table)
+    {
+        // compSize, alignedSize, uncompSize, flags, offset
+        constexpr size_t FIELDS_SIZE = 4 + 4 + 4 + 1 + OffsetSize;
+        constexpr size_t BATCH = 64;
+
+        std::string_view names[BATCH];
+        const uint8_t *fields[BATCH];
+        uint32_t rows[BATCH];
+        bool inserted[BATCH];
+
+        const uint8_t *p = data;
+        const uint8_t *end = data + size;
+        for (uint32_t base = 0; base < count; base += BATCH)
+        {
+            size_t n = std::min<size_t>(BATCH, count - base);
+
+            for (size_t i = 0; i < n; i++)
+            {
+                const uint8_t *terminator = FindTerminator(p, end);
+                if (static_cast<size_t>(end - terminator) < 1 + FIELDS_SIZE)
+                {
+                    return false;
+                }
+                names[i] = {reinterpret_cast<const char *>(p), static_cast<size_t>(terminator - p)};
+                fields[i] = terminator + 1;
+                p = fields[i] + FIELDS_SIZE;
+            }
+
+            index.FindOrInsertMany(names, n, rows, inserted);
+
+            for (size_t i = 0; i < n; i++)
+            {
+                uint32_t row = rows[i];
+                if (row == GrfNameIndex::npos)
+                {
+                    return false;
+                }
+                if (inserted[i])
+                {
+                    table.Append();
+                }
+
+                const uint8_t *f = fields[i];
+                memcpy(&table.compressedSize[row], f, 4);
+                memcpy(&table.compressedSizeAligned[row], f + 4, 4);
+                memcpy(&table.uncompressedSize[row], f + 8, 4);
+                table.flags[row] = f[12];
+
+                uint64_t offset = 0;
+                memcpy(&offset, f + 13, OffsetSize);
+                table.offset[row] = offset;
+            }
+        }
+        return true;
+    }
+
+    bool ParseGrfFileTable(const uint8_t *data, size_t size, uint32_t count, bool largeOffsets,
+                           GrfNameIndex &index, GrfFileTable &table)
+    {
+        // Cada entrada ocupa pelo menos 18 bytes: não reserva além do que a tabela comporta
+        size_t reserve = std::min<size_t>(count, size / 18);
+        index.Reserve(reserve);
+        table.Reserve(reserve);
+
+        return largeOffsets ? ParseEntries<8>(data, size, count, index, table)
+                            : ParseEntries<4>(data, size, count, index, table);
+    }
+
+} // namespace autopatch
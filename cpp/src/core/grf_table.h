@@ -0,0 +1,148 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <memory>
+#include <filesystem>
+#include <cstdint>
+
+namespace autopatch
+{
+
+    // Hash de nome de arquivo GRF normalizado: ignora maiúsculas/minúsculas (ASCII, só em
+    // caracteres de um byte; o segundo byte de um caractere CP949 é comparado como está)
+    // e trata '/' e '\' como o mesmo separador
+    uint32_t GrfNameHash(std::string_view name);
+
+    // Comparação de nomes com a mesma normalização do hash
+    bool GrfNameEquals(std::string_view a, std::string_view b);
+
+    // Ordem de nomes com a mesma normalização (< 0, 0 ou > 0, como memcmp)
+    int GrfNameCompare(std::string_view a, std::string_view b);
+
+    // Verifica se 'name' começa com 'prefix' (mesma normalização)
+    bool GrfNameStartsWith(std::string_view name, std::string_view prefix);
+
+    // Glob com a mesma normalização: '*' casa qualquer sequência (inclusive separadores)
+    // e '?' um caractere
+    bool GrfNameMatch(std::string_view name, std::string_view pattern);
+
+    // Nome interno (CP949, separador '\' ou '/') -> caminho relativo no sistema. Falha para
+    // nomes que sairiam do diretório de destino (raiz, letra de drive ou '..')
+    bool GrfNameToPath(std::string_view name, std::filesystem::path &path);
+
+    // Índice hash de endereçamento aberto (linear probing) para nomes de arquivos GRF.
+    // Os nomes ficam numa arena contígua em blocos (endereços estáveis) e cada nome
+    // recebe um id sequencial (a "linha" da tabela de arquivos).
+    class GrfNameIndex
+    {
+    public:
+        static constexpr uint32_t npos = 0xFFFFFFFF;
+
+        // Remove todos os nomes
+        void Clear();
+
+        // Pré-aloca espaço para 'count' nomes
+        void Reserve(size_t count);
+
+        // Número de nomes indexados
+        size_t Size() const { return m_hashes.size(); }
+
+        // Procura um nome; retorna a linha ou npos
+        uint32_t Find(std::string_view name) const;
+
+        // Procura vários nomes de uma vez (hashes calculados antes das sondagens)
+        void FindMany(const std::string_view *names, size_t count, uint32_t *rows) const;
+
+        // Adiciona um nome que ainda não existe; retorna a nova linha (npos se o nome for longo demais)
+        uint32_t Insert(std::string_view name);
+
+        // Procura um nome e o adiciona se não existir, calculando o hash uma vez só.
+        // 'inserted' indica se a linha é nova; retorna npos se o nome for longo demais.
+        uint32_t FindOrInsert(std::string_view name, bool &inserted);
+
+        // FindOrInsert em lote, na ordem de 'names' (mesmo prefetch de FindMany)
+        void FindOrInsertMany(const std::string_view *names, size_t count, uint32_t *rows, bool *inserted);
+
+        // Nome original (sem normalização) de uma linha
+        std::string_view Name(uint32_t row) const;
+
+        // Hash pré-calculado de uma linha
+        uint32_t Hash(uint32_t row) const { return m_hashes[row]; }
+
+        // Bytes usados pelo índice (slots + colunas por nome) e pela arena de nomes
+        size_t IndexMemoryUsage() const;
+        size_t NameMemoryUsage() const;
+
+        // Forma plana do índice para o índice persistido (.idx): colunas por nome,
+        // slots ({hash, linha}, 8 bytes cada) e blocos da arena como estão na memória
+        struct Image
+        {
+            std::span<const uint32_t> nameOffsets;
+            std::span<const uint16_t> nameLengths;
+            std::span<const uint32_t> hashes;
+            std::span<const uint8_t> slots;
+            std::vector<std::span<const char>> chunks;
+        };
+
+        Image Export() const;
+
+        // Substitui o conteúdo pelo de 'image' sem recalcular hashes nem reinserir nomes.
+        // Retorna false (índice vazio) se a imagem for inconsistente.
+        bool Import(const Image &image);
+
+    private:
+        // Slot da tabela hash: hash completo evita acessar o nome em colisões
+        struct Slot
+        {
+            uint32_t hash = 0;
+            uint32_t row = npos;
+        };
+
+        uint32_t Probe(std::string_view name, uint32_t hash) const;
+        uint32_t InsertHashed(std::string_view name, uint32_t hash);
+        uint32_t AppendName(std::string_view name);
+        void Rehash(size_t slotCount);
+
+        static constexpr size_t ARENA_CHUNK_SIZE = 1 << 20;
+
+        // Arena de nomes: nenhum nome atravessa blocos, offset = bloco * ARENA_CHUNK_SIZE + posição
+        std::vector<std::unique_ptr<char[]>> m_chunks;
+        size_t m_chunkUsed = ARENA_CHUNK_SIZE;
+
+        std::vector<uint32_t> m_nameOffsets;
+        std::vector<uint16_t> m_nameLengths;
+        std::vector<uint32_t> m_hashes;
+        std::vector<Slot> m_slots; // Tamanho potência de 2
+    };
+
+    // Tabela de arquivos GRF em colunas paralelas (structure-of-arrays),
+    // indexada pela mesma linha do GrfNameIndex. Nomes ficam no índice.
+    struct GrfFileTable
+    {
+        std::vector<uint32_t> compressedSize;
+        std::vector<uint32_t> compressedSizeAligned;
+        std::vector<uint32_t> uncompressedSize;
+        std::vector<uint64_t> offset;
+        std::vector<uint8_t> flags;
+
+        size_t Size() const { return flags.size(); }
+
+        void Clear();
+        void Reserve(size_t count);
+
+        // Adiciona uma linha zerada; retorna o índice
+        uint32_t Append();
+
+        size_t MemoryUsage() const;
+    };
+
+    // Parse da tabela de arquivos descomprimida (0x200/0x300) para o índice e as colunas.
+    // Nomes repetidos: a última entrada prevalece. Retorna false se a tabela terminar
+    // antes de 'count' entradas ou um nome for longo demais.
+    bool ParseGrfFileTable(const uint8_t *data, size_t size, uint32_t count, bool largeOffsets,
+                           GrfNameIndex &index, GrfFileTable &table);
+
+} // namespace autopatch
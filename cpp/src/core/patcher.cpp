@@ -4,8 +4,10 @@
 #include "thor.h"
 #include "utils.h"
 #include <sstream>
+#include <fstream>
 #include <algorithm>
 #include <cctype>
+#include <memory>
 #include <Windows.h>
 #include <shellapi.h>
 
@@ -155,7 +157,7 @@ namespace autopatch
         // Aplica patches
         m_status = PatcherStatus::Patching;
 
-        for (size_t i = 0; i < m_pendingPatches.size() && !m_cancelRequested; i++)
+        for (size_t i = 0; i < m_pendingPatches.size() && !m_cancelRequested;)
         {
             const auto &patch = m_pendingPatches[i];
 
@@ -163,11 +165,34 @@ namespace autopatch
             std::wstring msg = L"Applying " + utils::Utf8ToWide(patch.filename);
             ReportProgress(PatcherStatus::Patching, msg, progress);
 
-            ApplyPatch(patch);
+            // THORs seguidos para o mesmo GRF vão juntos (cada arquivo gravado uma vez)
+            bool success = false;
+            size_t applied = ApplyThorGroup(i, success);
+            if (applied == 0)
+            {
+                success = ApplyPatch(patch);
+                applied = 1;
+            }
 
-            // Marca patch como aplicado e salva
-            MarkPatchApplied(patch.filename);
+            // Patch com falha não é marcado (tenta de novo na próxima execução) e os
+            // seguintes não são aplicados sobre um estado incompleto
+            if (!success)
+            {
+                if (m_status != PatcherStatus::Error)
+                {
+                    m_status = PatcherStatus::Error;
+                    ReportProgress(PatcherStatus::Error, L"Falha ao aplicar patch: " + utils::Utf8ToWide(patch.filename), progress);
+                }
+                return;
+            }
+
+            // Marca patches como aplicados e salva
+            for (size_t j = i; j < i + applied; j++)
+            {
+                MarkPatchApplied(m_pendingPatches[j].filename);
+            }
             SaveAppliedPatches();
+            i += applied;
         }
 
         if (!m_cancelRequested)
@@ -428,7 +453,7 @@ namespace autopatch
         }
     }
 
-    void Patcher::ApplyPatch(const PatchInfo &patch)
+    bool Patcher::ApplyPatch(const PatchInfo &patch)
     {
         std::wstring tempPath = utils::GetTempDirectory() + utils::Utf8ToWide(patch.filename);
 
@@ -444,7 +469,7 @@ namespace autopatch
                                L" (erro " + std::to_wstring(error) + L")";
             OutputDebugStringW((L"[PATCH] ERRO: " + msg + L"\n").c_str());
             ReportProgress(PatcherStatus::Error, msg, 0.0f);
-            return;
+            return false;
         }
 
         // Obtém extensão do arquivo
@@ -489,6 +514,7 @@ namespace autopatch
 
         // Remove arquivo temporário
         utils::DeleteFileW(tempPath);
+        return success;
     }
 
     bool Patcher::ApplyThorPatch(const std::wstring &tempPath, const PatchInfo &patch)
@@ -509,28 +535,8 @@ namespace autopatch
         {
             OutputDebugStringW(L"[PATCH] THOR configurado para GRF merge\n");
 
-            // Determina qual GRF usar
-            std::string targetGrf;
-
-            // Primeiro, verifica se o THOR especifica um GRF alvo
-            if (!thor.GetTargetGrf().empty())
-            {
-                targetGrf = thor.GetTargetGrf();
-                OutputDebugStringA(("[PATCH] THOR especifica GRF alvo: " + targetGrf + "\n").c_str());
-            }
-            // Senão, usa o do patch info ou o primeiro da configuração
-            else if (!patch.targetGrf.empty())
-            {
-                targetGrf = patch.targetGrf;
-                OutputDebugStringA(("[PATCH] Usando GRF do patch: " + targetGrf + "\n").c_str());
-            }
-            else if (!m_grfFiles.empty())
-            {
-                targetGrf = m_grfFiles[0];
-                OutputDebugStringA(("[PATCH] Usando primeiro GRF da config: " + targetGrf + "\n").c_str());
-            }
-
-            if (targetGrf.empty())
+            std::wstring grfPath = GetThorGrfPath(thor, patch);
+            if (grfPath.empty())
             {
                 OutputDebugStringW(L"[PATCH] ERRO: Nenhum GRF alvo definido\n");
                 m_status = PatcherStatus::Error;
@@ -538,17 +544,11 @@ namespace autopatch
                 return false;
             }
 
-            // Constrói caminho completo do GRF (relativo ao diretório do app)
-            std::wstring grfPath = utils::Utf8ToWide(targetGrf);
-            if (grfPath.size() < 2 || grfPath[1] != L':')
-            {
-                // Caminho relativo - usa diretório do app
-                grfPath = utils::GetAppDirectory() + L"\\" + grfPath;
-            }
-
             OutputDebugStringW((L"[PATCH] Abrindo GRF: " + grfPath + L"\n").c_str());
 
             GrfFile grf;
+            grf.SetUseIndexFile(true);
+            grf.SetWriteBehind(true);
             if (grf.Open(grfPath))
             {
                 success = thor.ApplyTo(grf);
@@ -558,7 +558,9 @@ namespace autopatch
                 }
                 else
                 {
+                    // Não salva um patch aplicado pela metade (ele é reaplicado na próxima execução)
                     OutputDebugStringW(L"[PATCH] ERRO: Falha ao aplicar THOR ao GRF\n");
+                    grf.Discard();
                 }
             }
             else
@@ -595,6 +597,145 @@ namespace autopatch
         return success;
     }
 
+    std::wstring Patcher::GetThorGrfPath(const ThorFile &thor, const PatchInfo &patch) const
+    {
+        // Determina qual GRF usar
+        std::string targetGrf;
+
+        // Primeiro, verifica se o THOR especifica um GRF alvo
+        if (!thor.GetTargetGrf().empty())
+        {
+            targetGrf = thor.GetTargetGrf();
+            OutputDebugStringA(("[PATCH] THOR especifica GRF alvo: " + targetGrf + "\n").c_str());
+        }
+        // Senão, usa o do patch info ou o primeiro da configuração
+        else if (!patch.targetGrf.empty())
+        {
+            targetGrf = patch.targetGrf;
+            OutputDebugStringA(("[PATCH] Usando GRF do patch: " + targetGrf + "\n").c_str());
+        }
+        else if (!m_grfFiles.empty())
+        {
+            targetGrf = m_grfFiles[0];
+            OutputDebugStringA(("[PATCH] Usando primeiro GRF da config: " + targetGrf + "\n").c_str());
+        }
+
+        if (targetGrf.empty())
+        {
+            return {};
+        }
+
+        // Constrói caminho completo do GRF (relativo ao diretório do app)
+        std::wstring grfPath = utils::Utf8ToWide(targetGrf);
+        if (grfPath.size() < 2 || grfPath[1] != L':')
+        {
+            // Caminho relativo - usa diretório do app
+            grfPath = utils::GetAppDirectory() + L"\\" + grfPath;
+        }
+        return grfPath;
+    }
+
+    size_t Patcher::ApplyThorGroup(size_t first, bool &success)
+    {
+        /**
+         * THORs pendentes em sequência para o mesmo GRF são aplicados juntos: um plano
+         * guarda a última versão de cada caminho entre todos eles, cada arquivo é gravado
+         * uma vez e a tabela do GRF é gravada uma vez. Retorna quantos patches foram
+         * aplicados (0 = menos de dois THORs agrupáveis a partir de 'first'). O grupo é
+         * montado só com os headers; as tabelas são lidas apenas se ele tiver dois ou mais.
+         */
+        std::vector<std::wstring> paths;
+        std::wstring grfPath;
+        for (size_t i = first; i < m_pendingPatches.size(); i++)
+        {
+            std::wstring tempPath = utils::GetTempDirectory() + utils::Utf8ToWide(m_pendingPatches[i].filename);
+            std::wstring ext = utils::GetFileExtension(tempPath);
+            for (auto &c : ext)
+                c = towlower(c);
+            if (ext != L".thor")
+            {
+                break;
+            }
+
+            ThorFile header;
+            if (!header.OpenHeader(tempPath) || !header.UseGrfMerging())
+            {
+                break;
+            }
+
+            std::wstring target = GetThorGrfPath(header, m_pendingPatches[i]);
+            if (target.empty() || (!grfPath.empty() && _wcsicmp(target.c_str(), grfPath.c_str()) != 0))
+            {
+                break;
+            }
+            grfPath = target;
+            paths.push_back(std::move(tempPath));
+        }
+
+        if (paths.size() < 2)
+        {
+            return 0;
+        }
+
+        success = true;
+        std::vector<std::unique_ptr<ThorFile>> thors;
+        ThorPatchPlan plan;
+        for (const auto &path : paths)
+        {
+            auto thor = std::make_unique<ThorFile>();
+            if (!thor->Open(path))
+            {
+                OutputDebugStringW((L"[PATCH] ERRO: Falha ao abrir arquivo THOR: " + path + L"\n").c_str());
+                success = false;
+                break;
+            }
+            plan.Add(*thor);
+            thors.push_back(std::move(thor));
+        }
+
+        if (success)
+        {
+            OutputDebugStringW((L"[PATCH] Aplicando " + std::to_wstring(thors.size()) + L" THORs juntos em: " + grfPath +
+                                L" (" + std::to_wstring(plan.GetPathCount()) + L" caminhos, " +
+                                std::to_wstring(plan.GetSupersededCount()) + L" entradas sobrescritas)\n")
+                                   .c_str());
+
+            // Alguma entrada falhou: as alterações são descartadas (Discard, não Close, que
+            // salvaria), o GRF fica como estava e o grupo é reaplicado na próxima execução
+            GrfFile grf;
+            grf.SetUseIndexFile(true);
+            grf.SetWriteBehind(true);
+            if (grf.Open(grfPath))
+            {
+                success = plan.ApplyTo(grf) && grf.Save();
+                if (!success)
+                {
+                    grf.Discard();
+                }
+                grf.Close();
+            }
+            else
+            {
+                OutputDebugStringW((L"[PATCH] ERRO: Não foi possível abrir GRF: " + grfPath + L"\n").c_str());
+                success = false;
+            }
+        }
+
+        // Fecha os THORs antes de remover os arquivos temporários
+        thors.clear();
+        for (const auto &path : paths)
+        {
+            utils::DeleteFileW(path);
+        }
+
+        if (!success)
+        {
+            m_status = PatcherStatus::Error;
+            ReportProgress(PatcherStatus::Error, L"Falha ao aplicar patches THOR em " + grfPath, 0.0f);
+        }
+        return paths.size();
+    }
+
     bool Patcher::ApplyRgzPatch(const std::wstring &tempPath, const PatchInfo &patch)
     {
         // RGZ é um formato de arquivo comprimido que pode conter múltiplos arquivos
@@ -655,6 +796,7 @@ namespace autopatch
 
         // Abre a GRF de destino
         GrfFile destGrf;
+        destGrf.SetUseIndexFile(true);
         if (!destGrf.Open(destGrfPath))
         {
             OutputDebugStringW(L"[PATCH] ERRO: Não foi possível abrir GRF de destino\n");
@@ -663,47 +805,28 @@ namespace autopatch
             return false;
         }
 
-        // Obtém lista de arquivos da GRF source
-        auto fileList = sourceGrf.GetFileList();
-        OutputDebugStringW((L"[PATCH] Arquivos na GRF source: " + std::to_wstring(fileList.size()) + L"\n").c_str());
+        // Copia os blocos comprimidos da GRF source direto para a GRF de destino
+        OutputDebugStringW((L"[PATCH] Arquivos na GRF source: " + std::to_wstring(sourceGrf.GetFileCount()) + L"\n").c_str());
 
-        int successCount = 0;
-        int errorCount = 0;
+        bool merged = destGrf.Merge(sourceGrf, [this](uint64_t copiedBytes, uint64_t totalBytes)
+                                    {
+                                        float progress = totalBytes ? static_cast<float>(copiedBytes) / totalBytes : 1.0f;
+                                        ReportProgress(PatcherStatus::Patching,
+                                                       L"Merging GRF: " + std::to_wstring(copiedBytes / (1024 * 1024)) + L"/" +
+                                                           std::to_wstring(totalBytes / (1024 * 1024)) + L" MB",
+                                                       progress);
+                                    });
 
-        for (const auto &filename : fileList)
+        if (!merged)
         {
-            // Extrai arquivo da GRF source
-            auto data = sourceGrf.ExtractFile(filename);
-            if (data.empty())
-            {
-                OutputDebugStringA(("[PATCH] AVISO: Não foi possível extrair: " + filename + "\n").c_str());
-                errorCount++;
-                continue;
-            }
-
-            // Adiciona ao GRF de destino
-            if (destGrf.AddFile(filename, data))
-            {
-                OutputDebugStringA(("[PATCH] Merged: " + filename + "\n").c_str());
-                successCount++;
-            }
-            else
-            {
-                OutputDebugStringA(("[PATCH] ERRO ao adicionar: " + filename + "\n").c_str());
-                errorCount++;
-            }
-
-            // Reporta progresso
-            float progress = static_cast<float>(successCount + errorCount) / fileList.size();
-            ReportProgress(PatcherStatus::Patching,
-                           L"Merging GRF: " + std::to_wstring(successCount) + L"/" + std::to_wstring(fileList.size()),
-                           progress);
+            sourceGrf.Close();
+            destGrf.Close();
+            OutputDebugStringW(L"[PATCH] ERRO: Falha ao mesclar GRF\n");
+            m_status = PatcherStatus::Error;
+            ReportProgress(PatcherStatus::Error, L"Falha ao mesclar GRF: " + utils::Utf8ToWide(patch.filename), 0.0f);
+            return false;
         }
 
-        OutputDebugStringW((L"[PATCH] Merge concluído: " + std::to_wstring(successCount) +
-                            L" sucesso, " + std::to_wstring(errorCount) + L" erros\n")
-                               .c_str());
-
         // Fecha a GRF source (não precisamos mais)
         sourceGrf.Close();
 
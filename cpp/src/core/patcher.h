@@ -11,6 +11,8 @@
 namespace autopatch
 {
 
+    class ThorFile;
+
     // Tipo de destino do patch
     enum class PatchTarget
     {
@@ -88,8 +90,10 @@ namespace autopatch
         void WorkerThread();
         void DownloadPatchList();
         void DownloadPatch(const PatchInfo &patch);
-        void ApplyPatch(const PatchInfo &patch);
+        bool ApplyPatch(const PatchInfo &patch);
         bool ApplyThorPatch(const std::wstring &tempPath, const PatchInfo &patch);
+        size_t ApplyThorGroup(size_t first, bool &success);
+        std::wstring GetThorGrfPath(const ThorFile &thor, const PatchInfo &patch) const;
         bool ApplyRgzPatch(const std::wstring &tempPath, const PatchInfo &patch);
         bool ApplyGpfPatch(const std::wstring &tempPath, const PatchInfo &patch);
         bool MergeGrfPatch(const std::wstring &tempPath, const PatchInfo &patch);
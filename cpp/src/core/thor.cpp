@@ -1,8 +1,15 @@
 #include "thor.h"
 #include "grf.h"
+#include "grf_table.h"
+#include "codec.h"
+#include "thread_pool.h"
 #include <zlib.h>
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <cstdio>
+#include <filesystem>
+#include <unordered_map>
 #include <Windows.h>
 
 namespace autopatch
@@ -29,6 +36,26 @@ namespace autopatch
     }
 
     bool ThorFile::Open(const std::wstring &path)
+    {
+        if (!OpenHeader(path))
+        {
+            return false;
+        }
+
+        if (!ReadFileTable())
+        {
+            OutputDebugStringW(L"[THOR] ERRO: Falha ao ler tabela de arquivos\n");
+            Close();
+            return false;
+        }
+
+        OutputDebugStringW((L"[THOR] Arquivo aberto com sucesso. Arquivos: " +
+                            std::to_wstring(m_fileCount) + L"\n")
+                               .c_str());
+        return true;
+    }
+
+    bool ThorFile::OpenHeader(const std::wstring &path)
     {
         Close();
 
@@ -43,23 +70,20 @@ namespace autopatch
 
         m_path = path;
 
-        if (!ReadHeader())
+        if (!m_data.Open(path))
         {
-            OutputDebugStringW(L"[THOR] ERRO: Falha ao ler header\n");
+            OutputDebugStringW(L"[THOR] ERRO: Não foi possível abrir o arquivo\n");
             Close();
             return false;
         }
 
-        if (!ReadFileTable())
+        if (!ReadHeader())
         {
-            OutputDebugStringW(L"[THOR] ERRO: Falha ao ler tabela de arquivos\n");
+            OutputDebugStringW(L"[THOR] ERRO: Falha ao ler header\n");
             Close();
             return false;
         }
 
-        OutputDebugStringW((L"[THOR] Arquivo aberto com sucesso. Arquivos: " +
-                            std::to_wstring(m_fileCount) + L"\n")
-                               .c_str());
         m_isOpen = true;
         return true;
     }
@@ -70,6 +94,7 @@ namespace autopatch
         {
             m_file.close();
         }
+        m_data.Close();
 
         m_isOpen = false;
         m_mode = ThorMode::Invalid;
@@ -192,7 +217,12 @@ namespace autopatch
     bool ThorFile::ReadFileTable()
     {
         m_entries.clear();
-        m_entries.reserve(m_fileCount);
+
+        // m_fileCount vem do header sem validação: a reserva é só uma estimativa, limitada ao
+        // tamanho comprimido da tabela (um header corrompido não reserva gigabytes); se houver
+        // mais entradas, o vetor cresce normalmente
+        size_t tableBytes = m_mode == ThorMode::MultiFile ? m_fileTableCompLen : 1;
+        m_entries.reserve(std::min<size_t>(m_fileCount, tableBytes));
 
         if (m_mode == ThorMode::MultiFile)
         {
@@ -248,118 +278,113 @@ namespace autopatch
 
     bool ThorFile::ReadMultipleFilesTable()
     {
+        /**
+         * A tabela é descomprimida em stream (blocos de CodecContext::STREAM_CHUNK_SIZE) e as
+         * entradas são parseadas à medida que chegam; só o trecho de uma entrada incompleta
+         * fica guardado entre blocos. Não há estimativa de tamanho: a memória acompanha a
+         * tabela real, e o stream é lido direto do arquivo.
+         */
         OutputDebugStringW(L"[THOR] Lendo tabela de múltiplos arquivos (comprimida)\n");
 
-        // Ir para a tabela
-        m_file.seekg(m_fileTableOffset);
+        std::vector<uint8_t> pending;
+        uint64_t tableSize = 0;
+        auto parse = [&](const uint8_t *data, size_t size)
+        {
+            tableSize += size;
+            if (m_entries.size() >= m_fileCount)
+            {
+                return true; // Sobra após a última entrada
+            }
 
-        // Ler tabela comprimida
-        std::vector<uint8_t> compressedTable(m_fileTableCompLen);
-        m_file.read(reinterpret_cast<char *>(compressedTable.data()), m_fileTableCompLen);
+            pending.insert(pending.end(), data, data + size);
+            size_t consumed = ParseMultipleFilesEntries(pending.data(), pending.size());
+            pending.erase(pending.begin(), pending.begin() + consumed);
+            return true;
+        };
 
-        if (!m_file)
+        // Raw deflate (como .NET DeflateStream) primeiro; zlib só se nada foi descomprimido
+        CodecContext &codec = CodecContext::ForThread();
+        bool ok = false;
+        for (bool raw : {true, false})
         {
-            OutputDebugStringW(L"[THOR] ERRO: Falha ao ler tabela comprimida\n");
-            return false;
+            uint64_t position = m_fileTableOffset;
+            uint64_t remaining = m_fileTableCompLen;
+            auto read = [&](uint8_t *dst, size_t capacity, size_t &count)
+            {
+                count = static_cast<size_t>(std::min<uint64_t>(capacity, remaining));
+                if (count > 0 && !m_data.ReadAt(position, dst, count))
+                {
+                    return false;
+                }
+                position += count;
+                remaining -= count;
+                return true;
+            };
+
+            uint64_t totalIn = 0;
+            uint64_t totalOut = 0;
+            ok = codec.InflateStream(read, parse, raw, totalIn, totalOut);
+            if (ok || totalOut > 0)
+            {
+                break;
+            }
+            OutputDebugStringW(L"[THOR] Raw deflate falhou, tentando zlib\n");
         }
 
-        OutputDebugStringW((L"[THOR] Tabela comprimida lida: " + std::to_wstring(m_fileTableCompLen) + L" bytes\n").c_str());
-
-        // Estimar tamanho descomprimido (aproximadamente 10x)
-        size_t estimatedSize = m_fileTableCompLen * 20;
-        std::vector<uint8_t> table(estimatedSize);
-
-        // Tentar descomprimir com raw deflate (sem header zlib)
-        z_stream strm = {};
-        strm.next_in = compressedTable.data();
-        strm.avail_in = static_cast<uInt>(compressedTable.size());
-        strm.next_out = table.data();
-        strm.avail_out = static_cast<uInt>(table.size());
-
-        // -MAX_WBITS = raw deflate (sem header zlib), como .NET DeflateStream
-        int ret = inflateInit2(&strm, -MAX_WBITS);
-        if (ret != Z_OK)
+        if (!ok)
         {
-            OutputDebugStringW(L"[THOR] ERRO: inflateInit2 falhou\n");
+            OutputDebugStringW(L"[THOR] ERRO: Falha ao descomprimir tabela\n");
             return false;
         }
 
-        ret = inflate(&strm, Z_FINISH);
-        size_t decompressedSize = strm.total_out;
-        inflateEnd(&strm);
+        OutputDebugStringW((L"[THOR] Tabela descomprimida: " + std::to_wstring(tableSize) + L" bytes\n").c_str());
 
-        if (ret != Z_STREAM_END && ret != Z_OK)
+        if (m_entries.size() < m_fileCount)
         {
-            OutputDebugStringW((L"[THOR] Raw deflate falhou (ret=" + std::to_wstring(ret) + L"), tentando zlib\n").c_str());
-
-            // Tentar com zlib normal (com header)
-            uLongf destLen = static_cast<uLongf>(estimatedSize);
-            if (uncompress(table.data(), &destLen, compressedTable.data(), static_cast<uLong>(compressedTable.size())) != Z_OK)
-            {
-                OutputDebugStringW(L"[THOR] ERRO: Falha ao descomprimir tabela\n");
-                return false;
-            }
-            decompressedSize = destLen;
+            OutputDebugStringW((L"[THOR] Fim prematuro da tabela na entrada " + std::to_wstring(m_entries.size()) + L"\n").c_str());
         }
 
-        table.resize(decompressedSize);
-        OutputDebugStringW((L"[THOR] Tabela descomprimida: " + std::to_wstring(decompressedSize) + L" bytes\n").c_str());
+        OutputDebugStringW((L"[THOR] Total de entradas lidas: " + std::to_wstring(m_entries.size()) + L"\n").c_str());
+        return true;
+    }
 
-        // Parsear entradas
+    size_t ThorFile::ParseMultipleFilesEntries(const uint8_t *data, size_t size)
+    {
         // Formato GRF Editor:
         // - nameSize: 1 byte
         // - name: nameSize bytes
         // - flags: 1 byte (0x01 = remove)
         // Se não remove:
-        //   - offset: 4 bytes (relativo ao dataOffset)
+        //   - offset: 4 bytes (absoluto no arquivo)
         //   - sizeCompressed: 4 bytes
         //   - sizeDecompressed: 4 bytes
-
+        //
+        // Retorna quantos bytes formam entradas completas (o resto espera o próximo bloco)
         size_t pos = 0;
-        for (uint32_t i = 0; i < m_fileCount; i++)
+        while (m_entries.size() < m_fileCount && pos < size)
         {
-            if (pos >= table.size())
+            size_t nameLen = data[pos];
+            size_t flagsPos = pos + 1 + nameLen;
+            if (flagsPos >= size)
             {
-                OutputDebugStringW((L"[THOR] Fim prematuro da tabela na entrada " + std::to_wstring(i) + L"\n").c_str());
                 break;
             }
 
-            ThorEntry entry;
-
-            // Ler tamanho do nome
-            uint8_t nameLen = table[pos++];
-            if (pos + nameLen > table.size())
-                break;
-
-            entry.filename.assign(reinterpret_cast<char *>(&table[pos]), nameLen);
-            pos += nameLen;
-
-            // Ler flags
-            if (pos >= table.size())
+            uint8_t flags = data[flagsPos];
+            size_t entrySize = 1 + nameLen + 1 + ((flags & ENTRY_FLAG_REMOVE) ? 0 : 12);
+            if (pos + entrySize > size)
+            {
                 break;
-            entry.flags = table[pos++];
+            }
 
-            if ((entry.flags & ENTRY_FLAG_REMOVE) == 0)
+            ThorEntry entry;
+            entry.filename.assign(reinterpret_cast<const char *>(data + pos + 1), nameLen);
+            entry.flags = flags;
+            if ((flags & ENTRY_FLAG_REMOVE) == 0)
             {
-                // Ler offset (4 bytes)
-                if (pos + 4 > table.size())
-                    break;
-                memcpy(&entry.offset, &table[pos], 4);
-                // O offset é relativo ao início dos dados, não ao início do arquivo
-                // Mas na implementação de referência, o offset já é absoluto
-                pos += 4;
-
-                // Ler tamanho comprimido (4 bytes)
-                if (pos + 4 > table.size())
-                    break;
-                memcpy(&entry.compressedSize, &table[pos], 4);
-                pos += 4;
-
-                // Ler tamanho descomprimido (4 bytes)
-                if (pos + 4 > table.size())
-                    break;
-                memcpy(&entry.uncompressedSize, &table[pos], 4);
-                pos += 4;
+                memcpy(&entry.offset, data + flagsPos + 1, 4);
+                memcpy(&entry.compressedSize, data + flagsPos + 5, 4);
+                memcpy(&entry.uncompressedSize, data + flagsPos + 9, 4);
             }
             else
             {
@@ -374,18 +399,26 @@ namespace autopatch
             OutputDebugStringA("\n");
 
             m_entries.push_back(std::move(entry));
+            pos += entrySize;
         }
-
-        OutputDebugStringW((L"[THOR] Total de entradas lidas: " + std::to_wstring(m_entries.size()) + L"\n").c_str());
-        return true;
+        return pos;
     }
 
     std::vector<uint8_t> ThorFile::ExtractFile(const ThorEntry &entry)
     {
+        std::vector<uint8_t> data;
+        ExtractInto(entry, data);
+        return data;
+    }
+
+    bool ThorFile::ExtractInto(const ThorEntry &entry, std::vector<uint8_t> &out)
+    {
+        out.clear();
+
         if ((entry.flags & ENTRY_FLAG_REMOVE) != 0)
         {
             // Arquivo marcado para deleção
-            return {};
+            return false;
         }
 
         OutputDebugStringA("[THOR] Extraindo: ");
@@ -396,59 +429,137 @@ namespace autopatch
                             L", Size: " + std::to_wstring(entry.uncompressedSize) + L"\n")
                                .c_str());
 
-        // Posiciona no offset (os offsets no THOR já são absolutos)
-        m_file.seekg(entry.offset);
-
-        // Lê dados comprimidos
-        std::vector<uint8_t> compressed(entry.compressedSize);
-        m_file.read(reinterpret_cast<char *>(compressed.data()), entry.compressedSize);
+        // Se não está comprimido, lê direto na saída
+        if (entry.compressedSize == entry.uncompressedSize)
+        {
+            OutputDebugStringW(L"[THOR] Arquivo não comprimido\n");
+            if (!ReadCompressed(entry, out))
+            {
+                OutputDebugStringW(L"[THOR] ERRO: Falha ao ler dados do arquivo\n");
+                out.clear();
+                return false;
+            }
+            return true;
+        }
 
-        if (!m_file)
+        // Lê dados comprimidos num buffer do pool da thread
+        CodecContext &codec = CodecContext::ForThread();
+        std::vector<uint8_t> compressed = codec.Buffers().Acquire(entry.compressedSize);
+        if (!ReadCompressed(entry, compressed))
         {
             OutputDebugStringW(L"[THOR] ERRO: Falha ao ler dados do arquivo\n");
-            return {};
+            codec.Buffers().Release(std::move(compressed));
+            return false;
         }
 
-        // Se não está comprimido
-        if (entry.compressedSize == entry.uncompressedSize)
+        // Descomprime - tentar raw deflate primeiro (formato .NET DeflateStream), depois zlib normal
+        bool ok = true;
+        if (codec.Inflate(compressed.data(), compressed.size(), entry.uncompressedSize, out, true))
         {
-            OutputDebugStringW(L"[THOR] Arquivo não comprimido\n");
-            return compressed;
+            OutputDebugStringW(L"[THOR] Descomprimido com raw deflate\n");
+        }
+        else if (codec.Inflate(compressed.data(), compressed.size(), entry.uncompressedSize, out))
+        {
+            OutputDebugStringW(L"[THOR] Descomprimido com zlib\n");
+        }
+        else
+        {
+            OutputDebugStringW(L"[THOR] ERRO: Falha ao descomprimir dados\n");
+            ok = false;
         }
 
-        // Descomprime - tentar raw deflate primeiro (formato .NET DeflateStream)
-        std::vector<uint8_t> uncompressed(entry.uncompressedSize);
+        codec.Buffers().Release(std::move(compressed));
+        return ok;
+    }
 
-        z_stream strm = {};
-        strm.next_in = compressed.data();
-        strm.avail_in = static_cast<uInt>(compressed.size());
-        strm.next_out = uncompressed.data();
-        strm.avail_out = static_cast<uInt>(uncompressed.size());
+    bool ThorFile::ReadCompressed(const ThorEntry &entry, std::vector<uint8_t> &out)
+    {
+        // Os offsets no THOR já são absolutos
+        out.resize(entry.compressedSize);
+        return m_data.ReadAt(entry.offset, out.data(), out.size());
+    }
 
-        int ret = inflateInit2(&strm, -MAX_WBITS);
-        if (ret == Z_OK)
+    CodecContext::StreamReader ThorFile::OpenCompressed(const ThorEntry &entry)
+    {
+        // Posição e bytes restantes ficam no leitor: cada chamada lê o próximo bloco
+        uint64_t position = entry.offset;
+        uint64_t remaining = entry.compressedSize;
+        return [this, position, remaining](uint8_t *dst, size_t capacity, size_t &count) mutable
         {
-            ret = inflate(&strm, Z_FINISH);
-            inflateEnd(&strm);
+            count = static_cast<size_t>(std::min<uint64_t>(capacity, remaining));
+            if (count > 0 && !m_data.ReadAt(position, dst, count))
+            {
+                return false;
+            }
+
+            position += count;
+            remaining -= count;
+            return true;
+        };
+    }
 
-            if (ret == Z_STREAM_END)
+    bool ThorFile::ExtractTo(const ThorEntry &entry, const ThorSink &sink)
+    {
+        if ((entry.flags & ENTRY_FLAG_REMOVE) != 0)
+        {
+            // Arquivo marcado para deleção
+            return false;
+        }
+
+        OutputDebugStringA(("[THOR] Extraindo (stream): " + entry.filename + "\n").c_str());
+
+        CodecContext &codec = CodecContext::ForThread();
+
+        // Não comprimido: copia em blocos
+        if (entry.compressedSize == entry.uncompressedSize)
+        {
+            CodecContext::StreamReader read = OpenCompressed(entry);
+            std::vector<uint8_t> chunk = codec.Buffers().Acquire(CodecContext::STREAM_CHUNK_SIZE);
+            bool ok = true;
+            for (;;)
             {
-                OutputDebugStringW(L"[THOR] Descomprimido com raw deflate\n");
-                return uncompressed;
+                size_t count = 0;
+                if (!read(chunk.data(), chunk.size(), count))
+                {
+                    OutputDebugStringW(L"[THOR] ERRO: Falha ao ler dados do arquivo\n");
+                    ok = false;
+                    break;
+                }
+                if (count == 0)
+                {
+                    break;
+                }
+                if (!sink(chunk.data(), count))
+                {
+                    ok = false;
+                    break;
+                }
             }
+            codec.Buffers().Release(std::move(chunk));
+            return ok;
         }
 
-        // Tentar zlib normal
-        uLongf destLen = entry.uncompressedSize;
-        if (uncompress(uncompressed.data(), &destLen, compressed.data(), entry.compressedSize) == Z_OK)
+        // Raw deflate primeiro (formato .NET DeflateStream); zlib só se nada chegou ao sink
+        for (bool raw : {true, false})
         {
-            OutputDebugStringW(L"[THOR] Descomprimido com zlib\n");
-            uncompressed.resize(destLen);
-            return uncompressed;
+            uint64_t totalIn = 0;
+            uint64_t totalOut = 0;
+            if (codec.InflateStream(OpenCompressed(entry), sink, raw, totalIn, totalOut))
+            {
+                if (totalOut == entry.uncompressedSize)
+                {
+                    return true;
+                }
+                break;
+            }
+            if (totalOut > 0)
+            {
+                break;
+            }
         }
 
         OutputDebugStringW(L"[THOR] ERRO: Falha ao descomprimir dados\n");
-        return {};
+        return false;
     }
 
     bool ThorFile::ApplyTo(GrfFile &grf)
@@ -461,40 +572,176 @@ namespace autopatch
 
         OutputDebugStringW((L"[THOR] Aplicando " + std::to_wstring(m_entries.size()) + L" arquivos ao GRF\n").c_str());
 
-        for (const auto &entry : m_entries)
+        // Um patch sozinho é um plano de um THOR (entradas repetidas gravadas uma vez)
+        ThorPatchPlan plan;
+        plan.Add(*this);
+        return plan.ApplyTo(grf);
+    }
+
+    size_t ThorPatchPlan::NameHash::operator()(std::string_view name) const
+    {
+        return GrfNameHash(name);
+    }
+
+    bool ThorPatchPlan::NameEquals::operator()(std::string_view a, std::string_view b) const
+    {
+        return GrfNameEquals(a, b);
+    }
+
+    void ThorPatchPlan::Add(ThorFile &thor)
+    {
+        // Entrada posterior para o mesmo caminho substitui a anterior (no lugar dela)
+        for (const auto &entry : thor.GetEntries())
+        {
+            Item item = {&thor, m_thorCount, &entry};
+            auto [it, inserted] = m_byName.try_emplace(entry.filename, m_items.size());
+            if (inserted)
+            {
+                m_items.push_back(item);
+            }
+            else
+            {
+                m_items[it->second] = item;
+            }
+            m_entryCount++;
+        }
+        m_thorCount++;
+    }
+
+    bool ThorPatchPlan::ApplyTo(GrfFile &grf) const
+    {
+        if (!grf.IsOpen())
         {
+            OutputDebugStringW(L"[THOR] ERRO: GRF não está aberto\n");
+            return false;
+        }
+
+        OutputDebugStringW((L"[THOR] Plano: " + std::to_wstring(m_thorCount) + L" THORs, " +
+                            std::to_wstring(m_items.size()) + L" caminhos, " +
+                            std::to_wstring(GetSupersededCount()) + L" entradas sobrescritas\n")
+                               .c_str());
+
+        // Cada THOR é lido em ordem de offset (caminhos distintos: a ordem não muda o resultado)
+        std::vector<const Item *> order;
+        order.reserve(m_items.size());
+        for (const auto &item : m_items)
+        {
+            order.push_back(&item);
+        }
+        std::sort(order.begin(), order.end(), [](const Item *a, const Item *b)
+                  { return a->thorIndex != b->thorIndex ? a->thorIndex < b->thorIndex
+                                                        : a->entry->offset < b->entry->offset; });
+
+        // Arquivos a adicionar são acumulados e comprimidos em paralelo por AddFiles;
+        // entradas grandes não comprimidas vão em stream, sem passar pela memória
+        constexpr size_t APPLY_BATCH_BYTES = 64 * 1024 * 1024;
+        constexpr size_t APPLY_STREAM_BYTES = 16 * 1024 * 1024;
+        std::vector<GrfAddItem> batch;
+        size_t batchBytes = 0;
+        size_t failed = 0;
+
+        auto flushBatch = [&]()
+        {
+            if (!batch.empty())
+            {
+                size_t count = batch.size();
+                size_t stored = grf.AddFiles(std::move(batch));
+                if (stored != count)
+                {
+                    OutputDebugStringW((L"[THOR] ERRO: Lote gravou " + std::to_wstring(stored) + L" de " +
+                                        std::to_wstring(count) + L" arquivos\n")
+                                           .c_str());
+                    failed += count - stored;
+                }
+                batch.clear();
+                batchBytes = 0;
+            }
+        };
+
+        for (const Item *item : order)
+        {
+            ThorFile &thor = *item->thor;
+            const ThorEntry &entry = *item->entry;
+
             if ((entry.flags & ENTRY_FLAG_REMOVE) != 0)
             {
-                // Remove arquivo
                 OutputDebugStringA("[THOR] Removendo do GRF: ");
                 OutputDebugStringA(entry.filename.c_str());
                 OutputDebugStringA("\n");
-                grf.RemoveFile(entry.filename);
+
+                // Remover o que já não existe não é erro
+                if (!grf.RemoveFile(entry.filename) && grf.FileExists(entry.filename))
+                {
+                    OutputDebugStringA(("[THOR] ERRO: Falha ao remover: " + entry.filename + "\n").c_str());
+                    failed++;
+                }
+                continue;
             }
-            else
+
+            // Entrada comprimida: repassa o stream deflate sem descomprimir/recomprimir,
+            // em blocos (deflate puro) ou inteiro (stream zlib, copiado como está)
+            if (entry.compressedSize != entry.uncompressedSize)
             {
-                // Adiciona/atualiza arquivo
-                auto data = ExtractFile(entry);
-                if (!data.empty())
+                flushBatch();
+                bool copied = grf.AddCompressedFile(entry.filename, thor.OpenCompressed(entry), entry.uncompressedSize);
+
+                std::vector<uint8_t> compressed;
+                if (!copied && thor.ReadCompressed(entry, compressed))
                 {
-                    OutputDebugStringA("[THOR] Adicionando ao GRF: ");
-                    OutputDebugStringA(entry.filename.c_str());
-                    OutputDebugStringA("\n");
-                    grf.AddFile(entry.filename, data);
+                    copied = grf.AddCompressedFile(entry.filename, std::move(compressed), entry.uncompressedSize);
                 }
-                else
+
+                if (copied)
                 {
-                    OutputDebugStringA("[THOR] ERRO: Dados vazios para: ");
+                    OutputDebugStringA("[THOR] Copiado para o GRF: ");
                     OutputDebugStringA(entry.filename.c_str());
                     OutputDebugStringA("\n");
+                    continue;
                 }
             }
+            else if (entry.uncompressedSize >= APPLY_STREAM_BYTES)
+            {
+                flushBatch();
+                if (grf.AddFile(entry.filename, thor.OpenCompressed(entry), entry.uncompressedSize))
+                {
+                    continue;
+                }
+                OutputDebugStringA(("[THOR] AVISO: Stream falhou, extraindo em memória: " + entry.filename + "\n").c_str());
+            }
+
+            // Adiciona/atualiza arquivo (arquivo vazio é uma entrada válida)
+            std::vector<uint8_t> data;
+            if (!thor.ExtractInto(entry, data))
+            {
+                OutputDebugStringA("[THOR] ERRO: Falha ao extrair: ");
+                OutputDebugStringA(entry.filename.c_str());
+                OutputDebugStringA("\n");
+                failed++;
+                continue;
+            }
+
+            OutputDebugStringA("[THOR] Adicionando ao GRF: ");
+            OutputDebugStringA(entry.filename.c_str());
+            OutputDebugStringA("\n");
+            batchBytes += data.size();
+            batch.push_back({entry.filename, std::move(data)});
+            if (batchBytes >= APPLY_BATCH_BYTES)
+            {
+                flushBatch();
+            }
         }
 
+        flushBatch();
+
+        if (failed > 0)
+        {
+            OutputDebugStringW((L"[THOR] ERRO: " + std::to_wstring(failed) + L" entradas não foram aplicadas\n").c_str());
+            return false;
+        }
         return true;
     }
 
-    bool ThorFile::ApplyToDisk(const std::wstring &outputDir)
+    bool ThorFile::ApplyToDisk(const std::wstring &outputDir, ThreadPool *pool)
     {
         if (!m_isOpen)
         {
@@ -502,83 +749,113 @@ namespace autopatch
             return false;
         }
 
+        if (!pool)
+        {
+            pool = &ThreadPool::Default();
+        }
+
         OutputDebugStringW((L"[THOR] Extraindo " + std::to_wstring(m_entries.size()) +
                             L" arquivos para: " + outputDir + L"\n")
                                .c_str());
 
-        // Garante que outputDir termina com barra
-        std::wstring baseDir = outputDir;
-        if (!baseDir.empty() && baseDir.back() != L'\\' && baseDir.back() != L'/')
+        std::filesystem::path baseDir(outputDir);
+
+        // Uma tarefa por caminho, com a última entrada do patch para ele (nomes comparados
+        // sem diferenciar maiúsculas, como no sistema de arquivos do Windows)
+        struct DiskTask
         {
-            baseDir += L'\\';
-        }
+            const ThorEntry *entry;
+            std::wstring path;
+        };
+        std::vector<DiskTask> tasks;
+        tasks.reserve(m_entries.size());
+        std::unordered_map<std::string_view, size_t, ThorPatchPlan::NameHash, ThorPatchPlan::NameEquals> taskByName;
+        taskByName.reserve(m_entries.size());
+        size_t rejected = 0;
 
         for (const auto &entry : m_entries)
         {
-            // Converte caminho do arquivo para wide string
-            std::wstring relativePath;
-            for (char c : entry.filename)
+            // Nome CP949 -> caminho; '..', raiz ou drive escreveriam fora de outputDir
+            std::filesystem::path relative;
+            if (!GrfNameToPath(entry.filename, relative))
             {
-                if (c == '/')
-                    relativePath += L'\\';
-                else
-                    relativePath += static_cast<wchar_t>(c);
+                OutputDebugStringA(("[THOR] AVISO: Caminho fora do destino, ignorado: " + entry.filename + "\n").c_str());
+                rejected++;
+                continue;
             }
 
-            std::wstring fullPath = baseDir + relativePath;
-
-            if ((entry.flags & ENTRY_FLAG_REMOVE) != 0)
+            auto [it, inserted] = taskByName.try_emplace(entry.filename, tasks.size());
+            if (inserted)
             {
-                // Remove arquivo do disco
-                OutputDebugStringW((L"[THOR] Removendo do disco: " + fullPath + L"\n").c_str());
-                DeleteFileW(fullPath.c_str());
+                tasks.push_back({&entry, (baseDir / relative).wstring()});
             }
             else
             {
-                // Extrai arquivo para disco
-                auto data = ExtractFile(entry);
-                if (!data.empty())
-                {
-                    OutputDebugStringW((L"[THOR] Extraindo para: " + fullPath + L"\n").c_str());
-
-                    // Cria diretórios pai se necessário
-                    size_t pos = fullPath.find_last_of(L"\\/");
-                    if (pos != std::wstring::npos)
-                    {
-                        std::wstring dir = fullPath.substr(0, pos);
-                        // Cria recursivamente
-                        size_t p = 0;
-                        while ((p = dir.find_first_of(L"\\/", p + 1)) != std::wstring::npos)
-                        {
-                            CreateDirectoryW(dir.substr(0, p).c_str(), nullptr);
-                        }
-                        CreateDirectoryW(dir.c_str(), nullptr);
-                    }
-
-                    // Escreve arquivo
-                    HANDLE hFile = CreateFileW(fullPath.c_str(), GENERIC_WRITE, 0, nullptr,
-                                               CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-                    if (hFile != INVALID_HANDLE_VALUE)
-                    {
-                        DWORD written;
-                        WriteFile(hFile, data.data(), static_cast<DWORD>(data.size()), &written, nullptr);
-                        CloseHandle(hFile);
-                    }
-                    else
-                    {
-                        OutputDebugStringW((L"[THOR] ERRO: Não foi possível criar: " + fullPath + L"\n").c_str());
-                    }
-                }
-                else
-                {
-                    OutputDebugStringA("[THOR] ERRO: Dados vazios para: ");
-                    OutputDebugStringA(entry.filename.c_str());
-                    OutputDebugStringA("\n");
-                }
+                tasks[it->second].entry = &entry;
             }
         }
 
-        return true;
+        DirectoryCache directories;
+        std::atomic<size_t> failed{0};
+
+        pool->ParallelFor(tasks.size(), [&](size_t i)
+                          {
+                              const DiskTask &task = tasks[i];
+                              if ((task.entry->flags & ENTRY_FLAG_REMOVE) != 0)
+                              {
+                                  // Remove arquivo do disco
+                                  OutputDebugStringW((L"[THOR] Removendo do disco: " + task.path + L"\n").c_str());
+                                  DeleteFileW(task.path.c_str());
+                                  return;
+                              }
+
+                              // Cria diretórios pai se necessário
+                              directories.Ensure(std::filesystem::path(task.path).parent_path());
+
+                              if (!ExtractToFile(*task.entry, task.path))
+                              {
+                                  failed++;
+                              } });
+
+        OutputDebugStringW((L"[THOR] Extração concluída: " + std::to_wstring(tasks.size()) + L" caminhos, " +
+                            std::to_wstring(rejected) + L" ignorados, " + std::to_wstring(failed.load()) + L" falhas\n")
+                               .c_str());
+        return failed == 0;
+    }
+
+    bool ThorFile::ExtractToFile(const ThorEntry &entry, const std::wstring &path)
+    {
+        OutputDebugStringW((L"[THOR] Extraindo para: " + path + L"\n").c_str());
+
+        // Descomprime em stream direto para o arquivo
+        File output;
+        if (!output.Create(path))
+        {
+            OutputDebugStringW((L"[THOR] ERRO: Não foi possível criar: " + path + L"\n").c_str());
+            return false;
+        }
+
+        uint64_t written = 0;
+        bool ok = ExtractTo(entry, [&](const uint8_t *data, size_t size)
+                            {
+                                if (!output.WriteAt(written, data, size))
+                                {
+                                    return false;
+                                }
+                                written += size;
+                                return true;
+                            });
+        output.Close();
+
+        // Não deixa arquivo pela metade
+        if (!ok)
+        {
+            DeleteFileW(path.c_str());
+            OutputDebugStringA("[THOR] ERRO: Falha ao extrair: ");
+            OutputDebugStringA(entry.filename.c_str());
+            OutputDebugStringA("\n");
+        }
+        return ok;
     }
 
 } // namespace autopatch
@@ -3,13 +3,18 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <string_view>
 #include <cstdint>
 #include <fstream>
+#include "codec.h"
+#include "file_io.h"
 
 namespace autopatch
 {
 
     class GrfFile;
+    class ThreadPool;
 
     // Modos do arquivo THOR
     enum class ThorMode : uint8_t
@@ -29,6 +34,9 @@ namespace autopatch
         uint32_t uncompressedSize;
     };
 
+    // Destino de ExtractTo: recebe os dados descomprimidos em blocos (false = aborta)
+    using ThorSink = CodecContext::StreamWriter;
+
     // Classe para leitura de arquivos THOR
     class ThorFile
     {
@@ -39,6 +47,10 @@ namespace autopatch
         // Abre arquivo THOR
         bool Open(const std::wstring &path);
 
+        // Abre só o header (modo, GRF alvo, merge): GetEntries fica vazio e a tabela
+        // não é lida. Basta para decidir como aplicar o patch.
+        bool OpenHeader(const std::wstring &path);
+
         // Fecha arquivo
         void Close();
 
@@ -60,20 +72,41 @@ namespace autopatch
         // Extrai arquivo para memória
         std::vector<uint8_t> ExtractFile(const ThorEntry &entry);
 
+        // Extrai para 'out' reaproveitando a capacidade já alocada (sem alocação por arquivo
+        // quando 'out' é reutilizado entre chamadas)
+        bool ExtractInto(const ThorEntry &entry, std::vector<uint8_t> &out);
+
+        // Lê os bytes comprimidos de uma entrada como estão no THOR (deflate puro ou zlib)
+        bool ReadCompressed(const ThorEntry &entry, std::vector<uint8_t> &out);
+
+        // Extrai em stream para 'sink': o THOR é lido e descomprimido em blocos de
+        // CodecContext::STREAM_CHUNK_SIZE, então a memória não depende do tamanho da entrada
+        bool ExtractTo(const ThorEntry &entry, const ThorSink &sink);
+
+        // Leitor dos bytes comprimidos de uma entrada, em blocos (para os streams do GRF)
+        CodecContext::StreamReader OpenCompressed(const ThorEntry &entry);
+
         // Aplica patch a um GRF (merge)
         bool ApplyTo(GrfFile &grf);
 
-        // Aplica patch extraindo para disco
-        bool ApplyToDisk(const std::wstring &outputDir);
+        // Aplica patch extraindo para disco. Os arquivos são extraídos em paralelo no pool
+        // (nullptr = ThreadPool::Default()); quando o patch toca o mesmo caminho mais de
+        // uma vez, só a última entrada é aplicada, como na execução em ordem. Nomes que
+        // sairiam de outputDir ('..', raiz, drive) são ignorados e registrados no log, sem
+        // contar como falha (reaplicar o patch não os tornaria válidos).
+        bool ApplyToDisk(const std::wstring &outputDir, ThreadPool *pool = nullptr);
 
     private:
         bool ReadHeader();
         bool ReadFileTable();
         bool ReadSingleFileTable();
         bool ReadMultipleFilesTable();
+        size_t ParseMultipleFilesEntries(const uint8_t *data, size_t size);
+        bool ExtractToFile(const ThorEntry &entry, const std::wstring &path);
 
         std::wstring m_path;
         std::ifstream m_file;
+        File m_data; // Leitura posicional dos dados (pode ser usada por várias threads)
         bool m_isOpen = false;
 
         ThorMode m_mode = ThorMode::Invalid;
@@ -86,4 +119,52 @@ namespace autopatch
         std::vector<ThorEntry> m_entries;
     };
 
+    /**
+     * Plano de aplicação de vários THORs no mesmo GRF
+     *
+     * Lê as tabelas de todos os patches (na ordem de aplicação) e guarda, para cada
+     * caminho, só a última entrada que o toca (adição ou remoção). ApplyTo grava cada
+     * arquivo no GRF uma única vez; quem chama faz um único Save no final. Os nomes
+     * são comparados como no GRF (sem diferenciar maiúsculas, '/' == '\\').
+     */
+    class ThorPatchPlan
+    {
+    public:
+        // Acrescenta um THOR aberto, depois dos já adicionados. O ThorFile precisa
+        // continuar aberto até ApplyTo.
+        void Add(ThorFile &thor);
+
+        // Caminhos distintos no plano (uma ação por caminho)
+        size_t GetPathCount() const { return m_items.size(); }
+
+        // Entradas descartadas por serem sobrescritas por um patch posterior
+        size_t GetSupersededCount() const { return m_entryCount - m_items.size(); }
+
+        // Aplica a versão final de cada caminho ao GRF (sem gravar a tabela)
+        bool ApplyTo(GrfFile &grf) const;
+
+        // Chave de nome com a normalização do GrfNameIndex (também usada por ApplyToDisk)
+        struct NameHash
+        {
+            size_t operator()(std::string_view name) const;
+        };
+        struct NameEquals
+        {
+            bool operator()(std::string_view a, std::string_view b) const;
+        };
+
+    private:
+        struct Item
+        {
+            ThorFile *thor;
+            size_t thorIndex;
+            const ThorEntry *entry;
+        };
+
+        std::vector<Item> m_items;
+        std::unordered_map<std::string_view, size_t, NameHash, NameEquals> m_byName; // Nome -> m_items
+        size_t m_thorCount = 0;
+        size_t m_entryCount = 0;
+    };
+
 } // namespace autopatch
@@ -0,0 +1,535 @@
+#include "thor_writer.h"
+#include "codec.h"
+#include "grf_table.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <Windows.h>
+
+namespace autopatch
+{
+
+    // Mesmo layout lido por ThorFile::ReadHeader (formato GRF Editor)
+    static const char THOR_SIGNATURE[] = "ASSF (C) 2007 Aeomin DEV";
+    static const size_t MAGIC_SIZE = 24;
+    static const uint8_t ENTRY_FLAG_REMOVE = 0x01;
+
+    // Entrada da janela de compressão (soma das entradas lidas em memória de uma vez)
+    static const uint64_t WINDOW_SIZE = 64 * 1024 * 1024;
+
+    // Bytes que o zlib acrescenta ao deflate puro (header de 2 + Adler-32 de 4)
+    static const size_t ZLIB_HEADER_SIZE = 2;
+    static const size_t ZLIB_WRAPPER_SIZE = 6;
+
+    // Caminho relativo do sistema -> nome interno (CP949, separador '\\').
+    // false se algum caractere não existir em CP949.
+    static bool PathToThorName(const std::filesystem::path &relative, std::string &name)
+    {
+        std::wstring wide = relative.wstring();
+        std::replace(wide.begin(), wide.end(), L'/', L'\\');
+
+        name.clear();
+        if (wide.empty())
+        {
+            return false;
+        }
+
+        BOOL usedDefault = FALSE;
+        int size = WideCharToMultiByte(949, 0, wide.data(), static_cast<int>(wide.size()), nullptr, 0, nullptr, &usedDefault);
+        if (size <= 0 || usedDefault)
+        {
+            return false;
+        }
+        name.resize(size);
+        WideCharToMultiByte(949, 0, wide.data(), static_cast<int>(wide.size()), name.data(), size, nullptr, nullptr);
+        return true;
+    }
+
+    size_t ThorWriter::NameHash::operator()(std::string_view name) const
+    {
+        return GrfNameHash(name);
+    }
+
+    bool ThorWriter::NameEquals::operator()(std::string_view a, std::string_view b) const
+    {
+        return GrfNameEquals(a, b);
+    }
+
+    void ThorWriter::Push(Item item)
+    {
+        // Mesmo nome (sem diferenciar maiúsculas, '/' == '\\'): a última alteração substitui
+        auto it = m_byName.find(item.filename);
+        if (it != m_byName.end())
+        {
+            m_items[it->second] = std::move(item);
+            return;
+        }
+
+        m_byName.emplace(item.filename, m_items.size());
+        m_items.push_back(std::move(item));
+    }
+
+    void ThorWriter::AddSource(const std::string &filename, const std::wstring &sourcePath, uint64_t size)
+    {
+        Item item;
+        item.filename = filename;
+        item.sourcePath = sourcePath;
+        item.size = size;
+        Push(std::move(item));
+    }
+
+    bool ThorWriter::AddFile(const std::string &filename, const std::wstring &sourcePath)
+    {
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(std::filesystem::path(sourcePath), ec);
+        if (ec)
+        {
+            OutputDebugStringW((L"[THOR] ERRO: Arquivo não encontrado: " + sourcePath + L"\n").c_str());
+            return false;
+        }
+
+        AddSource(filename, sourcePath, size);
+        return true;
+    }
+
+    void ThorWriter::AddFile(const std::string &filename, std::vector<uint8_t> data)
+    {
+        Item item;
+        item.filename = filename;
+        item.size = data.size();
+        item.data = std::move(data);
+        Push(std::move(item));
+    }
+
+    void ThorWriter::RemoveFile(const std::string &filename)
+    {
+        Item item;
+        item.filename = filename;
+        item.remove = true;
+        Push(std::move(item));
+    }
+
+    size_t ThorWriter::AddDirectory(const std::wstring &directory, const std::string &prefix)
+    {
+        std::filesystem::path base(directory);
+        std::vector<std::pair<std::filesystem::path, uint64_t>> files;
+
+        // O tamanho vem da listagem do diretório (sem abrir cada arquivo)
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(base, ec);
+             !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+        {
+            std::error_code entryError;
+            if (it->is_regular_file(entryError))
+            {
+                uint64_t size = it->file_size(entryError);
+                if (!entryError)
+                {
+                    files.emplace_back(it->path(), size);
+                }
+            }
+        }
+        if (ec)
+        {
+            OutputDebugStringW((L"[THOR] Falha ao listar diretório: " + directory + L"\n").c_str());
+        }
+
+        // Ordem estável (o iterador não garante nenhuma)
+        std::sort(files.begin(), files.end());
+
+        size_t added = 0;
+        for (const auto &[file, size] : files)
+        {
+            std::string name;
+            if (!PathToThorName(file.lexically_relative(base), name))
+            {
+                OutputDebugStringW((L"[THOR] ERRO: Caminho sem representação em CP949, ignorado: " + file.wstring() + L"\n").c_str());
+                continue;
+            }
+            AddSource(prefix + name, file.wstring(), size);
+            added++;
+        }
+
+        OutputDebugStringW((L"[THOR] " + std::to_wstring(added) + L" arquivos adicionados de " + directory + L"\n").c_str());
+        return added;
+    }
+
+    bool ThorWriter::Write(const std::wstring &path, ThorMode mode, ThreadPool *pool)
+    {
+        if (mode != ThorMode::MultiFile && mode != ThorMode::SingleFile)
+        {
+            return false;
+        }
+        if (m_items.empty())
+        {
+            OutputDebugStringW(L"[THOR] ERRO: Nenhuma alteração para gravar\n");
+            return false;
+        }
+        if (mode == ThorMode::SingleFile && (m_items.size() != 1 || m_items[0].remove))
+        {
+            OutputDebugStringW(L"[THOR] ERRO: SingleFile exige exatamente um arquivo\n");
+            return false;
+        }
+        if (m_targetGrf.size() > 255)
+        {
+            OutputDebugStringW(L"[THOR] ERRO: Nome do GRF alvo excede 255 bytes\n");
+            return false;
+        }
+        for (const auto &item : m_items)
+        {
+            if (item.filename.empty() || item.filename.size() > 255)
+            {
+                OutputDebugStringA(("[THOR] ERRO: Nome de entrada inválido: " + item.filename + "\n").c_str());
+                return false;
+            }
+        }
+
+        OutputDebugStringW((L"[THOR] Gerando patch com " + std::to_wstring(m_items.size()) + L" entradas\n").c_str());
+
+        // Header: assinatura, UseGrfMerging, NumberOfFiles, Mode, GRF alvo e
+        // (MultiFile) FileTableCompLen + FileTableOffset ou (SingleFile) FileTableOffset de 8 bytes
+        const uint64_t headerSize = MAGIC_SIZE + 1 + 4 + 2 + 1 + m_targetGrf.size() + 8;
+
+        std::wstring tempPath = path + L".tmp";
+        File out;
+        if (!out.Create(tempPath))
+        {
+            OutputDebugStringW((L"[THOR] ERRO: Falha ao criar " + tempPath + L"\n").c_str());
+            return false;
+        }
+
+        uint64_t pos = headerSize;
+        std::vector<Written> written(m_items.size());
+        bool ok = WriteData(out, pos, pool ? *pool : ThreadPool::Default(), written);
+
+        // Tabela de arquivos (ThorFile guarda offsets de 32 bits nos dois modos)
+        uint64_t tableOffset = pos;
+        std::vector<uint8_t> table;
+        if (ok && tableOffset > UINT32_MAX)
+        {
+            OutputDebugStringW(L"[THOR] ERRO: Região de dados excede 4 GB\n");
+            ok = false;
+        }
+
+        auto put = [&table](const void *data, size_t size)
+        {
+            const uint8_t *bytes = static_cast<const uint8_t *>(data);
+            table.insert(table.end(), bytes, bytes + size);
+        };
+
+        for (size_t i = 0; ok && i < m_items.size(); i++)
+        {
+            const Item &item = m_items[i];
+            uint8_t nameLen = static_cast<uint8_t>(item.filename.size());
+            uint8_t flags = item.remove ? ENTRY_FLAG_REMOVE : 0;
+            put(&nameLen, 1);
+            put(item.filename.data(), nameLen);
+            put(&flags, 1);
+            if (item.remove)
+            {
+                continue;
+            }
+
+            if (mode == ThorMode::MultiFile)
+            {
+                uint32_t offset = static_cast<uint32_t>(written[i].offset);
+                put(&offset, 4);
+            }
+            else
+            {
+                put(&written[i].offset, 8);
+            }
+            put(&written[i].compressedSize, 4);
+            put(&written[i].uncompressedSize, 4);
+        }
+
+        // MultiFile: tabela em deflate puro (como a dos dados)
+        uint32_t tableSize = static_cast<uint32_t>(table.size());
+        if (ok && mode == ThorMode::MultiFile)
+        {
+            std::vector<uint8_t> deflated;
+            ok = CodecContext::ForThread().Deflate(table.data(), table.size(), deflated) &&
+                 deflated.size() >= ZLIB_WRAPPER_SIZE;
+            if (ok)
+            {
+                table.assign(deflated.begin() + ZLIB_HEADER_SIZE, deflated.end() - (ZLIB_WRAPPER_SIZE - ZLIB_HEADER_SIZE));
+                tableSize = static_cast<uint32_t>(table.size());
+            }
+        }
+        ok = ok && out.WriteAt(tableOffset, table.data(), table.size());
+
+        if (ok)
+        {
+            std::vector<uint8_t> header;
+            auto append = [&header](const void *data, size_t size)
+            {
+                const uint8_t *bytes = static_cast<const uint8_t *>(data);
+                header.insert(header.end(), bytes, bytes + size);
+            };
+
+            uint8_t useGrfMerging = m_useGrfMerging ? 1 : 0;
+            uint32_t fileCount = static_cast<uint32_t>(m_items.size());
+            uint16_t modeValue = static_cast<uint16_t>(mode);
+            uint8_t targetLen = static_cast<uint8_t>(m_targetGrf.size());
+            append(THOR_SIGNATURE, MAGIC_SIZE);
+            append(&useGrfMerging, 1);
+            append(&fileCount, 4);
+            append(&modeValue, 2);
+            append(&targetLen, 1);
+            append(m_targetGrf.data(), m_targetGrf.size());
+            if (mode == ThorMode::MultiFile)
+            {
+                uint32_t offset = static_cast<uint32_t>(tableOffset);
+                append(&tableSize, 4);
+                append(&offset, 4);
+            }
+            else
+            {
+                append(&tableOffset, 8);
+            }
+
+            // O Adler-32 da última entrada em stream pode ter ficado depois da tabela
+            ok = header.size() == headerSize && out.WriteAt(0, header.data(), header.size()) &&
+                 out.Resize(tableOffset + table.size());
+        }
+
+        out.Close();
+
+        std::error_code ec;
+        if (ok)
+        {
+            std::filesystem::rename(std::filesystem::path(tempPath), std::filesystem::path(path), ec);
+        }
+        if (!ok || ec)
+        {
+            std::filesystem::remove(std::filesystem::path(tempPath), ec);
+            OutputDebugStringW((L"[THOR] ERRO: Falha ao gravar " + path + L"\n").c_str());
+            return false;
+        }
+
+        OutputDebugStringW((L"[THOR] Patch gerado: " + std::to_wstring(tableOffset + table.size()) + L" bytes\n").c_str());
+        return true;
+    }
+
+    bool ThorWriter::WriteData(File &out, uint64_t &pos, ThreadPool &pool, std::vector<Written> &written)
+    {
+        /**
+         * Janelas de até WINDOW_SIZE bytes de entrada, na ordem das alterações: cada janela é
+         * lida e comprimida em paralelo no pool, depois gravada em sequência a partir de 'pos'.
+         * Entradas maiores que a janela são comprimidas em stream direto no destino.
+         */
+        // Tamanhos registrados no AddFile/AddDirectory: nenhum arquivo é aberto aqui
+        std::vector<uint64_t> sizes(m_items.size(), 0);
+        for (size_t i = 0; i < m_items.size(); i++)
+        {
+            const Item &item = m_items[i];
+            if (item.remove)
+            {
+                continue;
+            }
+
+            sizes[i] = item.size;
+            if (sizes[i] > UINT32_MAX)
+            {
+                OutputDebugStringA(("[THOR] ERRO: Arquivo excede 4 GB: " + item.filename + "\n").c_str());
+                return false;
+            }
+        }
+
+        struct Slot
+        {
+            size_t index;
+            std::vector<uint8_t> input;
+            std::vector<uint8_t> deflated; // zlib; vazio = gravar sem compressão
+        };
+
+        uint64_t totalIn = 0;
+        size_t next = 0;
+        while (next < m_items.size())
+        {
+            if (m_items[next].remove)
+            {
+                next++;
+                continue;
+            }
+
+            if (sizes[next] > WINDOW_SIZE)
+            {
+                if (!WriteStreamed(out, pos, m_items[next], sizes[next], written[next]))
+                {
+                    return false;
+                }
+                totalIn += sizes[next];
+                next++;
+                continue;
+            }
+
+            // Monta a janela com as próximas entradas que cabem nela
+            std::vector<Slot> window;
+            uint64_t windowBytes = 0;
+            while (next < m_items.size() && (m_items[next].remove || sizes[next] <= WINDOW_SIZE - windowBytes))
+            {
+                if (!m_items[next].remove)
+                {
+                    window.push_back({next, {}, {}});
+                    windowBytes += sizes[next];
+                }
+                next++;
+            }
+
+            std::atomic<bool> failed{false};
+            pool.ParallelFor(window.size(), [&](size_t i)
+                             {
+                Slot &slot = window[i];
+                const Item &item = m_items[slot.index];
+                const uint64_t size = sizes[slot.index];
+
+                const uint8_t *data = item.data.data();
+                if (!item.sourcePath.empty())
+                {
+                    File source;
+                    slot.input.resize(static_cast<size_t>(size));
+                    // O arquivo não pode ter mudado de tamanho desde o AddFile
+                    if (!source.Open(item.sourcePath) || source.Size() != size ||
+                        !source.ReadAt(0, slot.input.data(), slot.input.size()))
+                    {
+                        failed = true;
+                        return;
+                    }
+                    data = slot.input.data();
+                }
+
+                // Só vale comprimir se o deflate puro ficar menor que o original
+                if (!CodecContext::ForThread().Deflate(data, static_cast<size_t>(size), slot.deflated) ||
+                    slot.deflated.size() - ZLIB_WRAPPER_SIZE >= size)
+                {
+                    slot.deflated.clear();
+                }
+                else
+                {
+                    slot.input = {};
+                } });
+
+            if (failed)
+            {
+                OutputDebugStringW(L"[THOR] ERRO: Falha ao ler arquivo de origem (ausente ou com tamanho alterado)\n");
+                return false;
+            }
+
+            for (Slot &slot : window)
+            {
+                const Item &item = m_items[slot.index];
+                const uint64_t size = sizes[slot.index];
+
+                const uint8_t *data;
+                size_t length;
+                if (!slot.deflated.empty())
+                {
+                    data = slot.deflated.data() + ZLIB_HEADER_SIZE;
+                    length = slot.deflated.size() - ZLIB_WRAPPER_SIZE;
+                }
+                else
+                {
+                    data = item.sourcePath.empty() ? item.data.data() : slot.input.data();
+                    length = static_cast<size_t>(size);
+                }
+
+                if (length > 0 && !out.WriteAt(pos, data, length))
+                {
+                    return false;
+                }
+
+                Written &entry = written[slot.index];
+                entry.offset = pos;
+                entry.compressedSize = static_cast<uint32_t>(length);
+                entry.uncompressedSize = static_cast<uint32_t>(size);
+                pos += length;
+                totalIn += size;
+
+                slot.input = {};
+                slot.deflated = {};
+            }
+        }
+
+        OutputDebugStringW((L"[THOR] Dados: " + std::to_wstring(totalIn) + L" bytes -> " +
+                            std::to_wstring(pos) + L" bytes no arquivo\n")
+                               .c_str());
+        return true;
+    }
+
+    bool ThorWriter::WriteStreamed(File &out, uint64_t &pos, const Item &item, uint64_t size, Written &entry)
+    {
+        File source;
+        if (!item.sourcePath.empty() && (!source.Open(item.sourcePath) || source.Size() != size))
+        {
+            OutputDebugStringW((L"[THOR] ERRO: Falha ao abrir (ou tamanho alterado) " + item.sourcePath + L"\n").c_str());
+            return false;
+        }
+
+        uint64_t readPos = 0;
+        auto read = [&](uint8_t *dst, size_t capacity, size_t &count)
+        {
+            count = static_cast<size_t>(std::min<uint64_t>(capacity, size - readPos));
+            if (count > 0)
+            {
+                if (item.sourcePath.empty())
+                {
+                    memcpy(dst, item.data.data() + readPos, count);
+                }
+                else if (!source.ReadAt(readPos, dst, count))
+                {
+                    return false;
+                }
+            }
+            readPos += count;
+            return true;
+        };
+
+        // Grava o stream zlib sem os 2 bytes de header; o Adler-32 do fim é sobrescrito
+        // pela próxima entrada (ou cortado no Resize final)
+        uint64_t skip = ZLIB_HEADER_SIZE;
+        uint64_t writePos = pos;
+        auto write = [&](const uint8_t *data, size_t count)
+        {
+            size_t skipped = static_cast<size_t>(std::min<uint64_t>(skip, count));
+            skip -= skipped;
+            if (count > skipped && !out.WriteAt(writePos, data + skipped, count - skipped))
+            {
+                return false;
+            }
+            writePos += count - skipped;
+            return true;
+        };
+
+        uint64_t totalIn = 0;
+        uint64_t totalOut = 0;
+        if (!CodecContext::ForThread().DeflateStream(read, write, totalIn, totalOut) ||
+            totalIn != size || totalOut < ZLIB_WRAPPER_SIZE)
+        {
+            OutputDebugStringA(("[THOR] ERRO: Falha ao comprimir " + item.filename + "\n").c_str());
+            return false;
+        }
+
+        uint64_t length = totalOut - ZLIB_WRAPPER_SIZE;
+        if (length >= size)
+        {
+            // Não comprimiu: regrava o original por cima
+            bool copied = item.sourcePath.empty() ? out.WriteAt(pos, item.data.data(), static_cast<size_t>(size))
+                                                  : File::CopyRange(source, 0, out, pos, size);
+            if (!copied)
+            {
+                return false;
+            }
+            length = size;
+        }
+
+        entry.offset = pos;
+        entry.compressedSize = static_cast<uint32_t>(length);
+        entry.uncompressedSize = static_cast<uint32_t>(size);
+        pos += length;
+        return true;
+    }
+
+} // namespace autopatch
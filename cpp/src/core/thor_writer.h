@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <string_view>
+#include <cstdint>
+#include "thor.h"
+
+namespace autopatch
+{
+
+    class ThreadPool;
+
+    /**
+     * Gerador de arquivos THOR
+     *
+     * Monta um patch a partir de uma lista de alterações (arquivos do disco, dados em
+     * memória e remoções) ou de um diretório inteiro, no mesmo layout que ThorFile lê:
+     * MultiFile (tabela em deflate puro no fim) ou SingleFile (uma entrada).
+     *
+     * Write comprime as entradas em paralelo, em janelas de até 64 MB, e grava a região
+     * de dados numa única passada sequencial, na ordem das alterações. Arquivos grandes
+     * são comprimidos em stream direto no destino. Os dados ficam em deflate puro
+     * (formato do .NET DeflateStream); entradas que não diminuem são gravadas sem compressão.
+     */
+    class ThorWriter
+    {
+    public:
+        // GRF alvo gravado no header (vazio = o patcher decide)
+        void SetTargetGrf(const std::string &grfName) { m_targetGrf = grfName; }
+
+        // true = merge no GRF, false = extração para o disco
+        void SetUseGrfMerging(bool enabled) { m_useGrfMerging = enabled; }
+
+        // Adiciona/atualiza 'filename' com o conteúdo de um arquivo do disco (lido no Write).
+        // O tamanho é registrado agora; false se o arquivo não existir.
+        bool AddFile(const std::string &filename, const std::wstring &sourcePath);
+
+        // Adiciona/atualiza 'filename' com dados em memória
+        void AddFile(const std::string &filename, std::vector<uint8_t> data);
+
+        // Remove 'filename' do destino
+        void RemoveFile(const std::string &filename);
+
+        // Adiciona todos os arquivos sob 'directory' (recursivo). O nome de cada entrada é
+        // o caminho relativo com '\' como separador, precedido de 'prefix'. Arquivos cujo
+        // caminho não tem representação em CP949 são ignorados (com log).
+        // Retorna quantos arquivos foram adicionados.
+        size_t AddDirectory(const std::wstring &directory, const std::string &prefix = {});
+
+        // Alterações registradas (uma por nome: a última vale)
+        size_t GetEntryCount() const { return m_items.size(); }
+
+        // Grava o THOR em 'path' (via arquivo temporário + rename). A compressão roda no
+        // pool (nullptr = ThreadPool::Default()). SingleFile exige exatamente uma adição;
+        // MultiFile guarda offsets de 32 bits (região de dados até 4 GB).
+        bool Write(const std::wstring &path, ThorMode mode = ThorMode::MultiFile, ThreadPool *pool = nullptr);
+
+    private:
+        struct Item
+        {
+            std::string filename;
+            std::wstring sourcePath; // Vazio = 'data'
+            std::vector<uint8_t> data;
+            uint64_t size = 0; // Tamanho do conteúdo (do disco, registrado no AddFile)
+            bool remove = false;
+        };
+
+        // Entrada como vai para a tabela
+        struct Written
+        {
+            uint64_t offset = 0;
+            uint32_t compressedSize = 0;
+            uint32_t uncompressedSize = 0;
+        };
+
+        struct NameHash
+        {
+            size_t operator()(std::string_view name) const;
+        };
+        struct NameEquals
+        {
+            bool operator()(std::string_view a, std::string_view b) const;
+        };
+
+        void Push(Item item);
+        void AddSource(const std::string &filename, const std::wstring &sourcePath, uint64_t size);
+        bool WriteData(File &out, uint64_t &pos, ThreadPool &pool, std::vector<Written> &written);
+        bool WriteStreamed(File &out, uint64_t &pos, const Item &item, uint64_t size, Written &entry);
+
+        std::vector<Item> m_items;
+        std::unordered_map<std::string, size_t, NameHash, NameEquals> m_byName; // Nome -> m_items
+        std::string m_targetGrf;
+        bool m_useGrfMerging = true;
+    };
+
+} // namespace autopatch
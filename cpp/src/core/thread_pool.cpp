@@ -0,0 +1,117 @@
+#include "thread_pool.h"
+#include <atomic>
+#include <algorithm>
+
+namespace autopatch
+{
+
+    ThreadPool::ThreadPool(size_t threadCount)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        m_threads.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++)
+        {
+            m_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_cv.notify_all();
+
+        for (auto &thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    void ThreadPool::Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_cv.notify_one();
+    }
+
+    void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)> &fn)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        // Cada executor retira o próximo índice livre até acabar
+        std::atomic<size_t> next{0};
+        auto run = [&]()
+        {
+            for (size_t i = next++; i < count; i = next++)
+            {
+                fn(i);
+            }
+        };
+
+        size_t helpers = std::min(m_threads.size(), count - 1);
+        size_t pending = helpers;
+        std::mutex doneMutex;
+        std::condition_variable doneCv;
+
+        for (size_t i = 0; i < helpers; i++)
+        {
+            Submit([&]()
+                   {
+                       run();
+
+                       std::lock_guard<std::mutex> lock(doneMutex);
+                       if (--pending == 0)
+                       {
+                           doneCv.notify_one();
+                       }
+                   });
+        }
+
+        run();
+
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCv.wait(lock, [&]()
+                    { return pending == 0; });
+    }
+
+    ThreadPool &ThreadPool::Default()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    void ThreadPool::WorkerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]()
+                          { return m_stopping || !m_tasks.empty(); });
+
+                if (m_stopping && m_tasks.empty())
+                {
+                    return;
+                }
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+
+            task();
+        }
+    }
+
+} // namespace autopatch
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+namespace autopatch
+{
+
+    // Pool fixo de threads para trabalho de CPU (compressão, descompressão)
+    class ThreadPool
+    {
+    public:
+        // 0 = número de núcleos lógicos
+        explicit ThreadPool(size_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        size_t GetThreadCount() const { return m_threads.size(); }
+
+        // Enfileira uma tarefa
+        void Submit(std::function<void()> task);
+
+        // Executa fn(i) para i em [0, count) nas threads do pool e espera todas terminarem.
+        // A thread chamadora também participa. Não deve ser chamado de dentro de uma tarefa do pool.
+        void ParallelFor(size_t count, const std::function<void(size_t)> &fn);
+
+        // Pool compartilhado do processo (criado no primeiro uso)
+        static ThreadPool &Default();
+
+    private:
+        void WorkerLoop();
+
+        std::vector<std::thread> m_threads;
+        std::deque<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_stopping = false;
+    };
+
+} // namespace autopatch
@@ -1,5 +1,5 @@
 #include "utils.h"
-#include <zlib.h>
+#include "codec.h"
 #include <wincrypt.h>
 #include <Shlwapi.h>
 #include <ShlObj.h>
@@ -396,29 +396,21 @@ namespace autopatch
 
     std::vector<uint8_t> Compress(const std::vector<uint8_t> &data)
     {
-        uLongf compressedSize = compressBound(static_cast<uLong>(data.size()));
-        std::vector<uint8_t> compressed(compressedSize);
-
-        if (compress(compressed.data(), &compressedSize, data.data(), static_cast<uLong>(data.size())) != Z_OK)
+        std::vector<uint8_t> compressed;
+        if (!CodecContext::ForThread().Deflate(data.data(), data.size(), compressed))
         {
             return {};
         }
-
-        compressed.resize(compressedSize);
         return compressed;
     }
 
     std::vector<uint8_t> Decompress(const std::vector<uint8_t> &data, size_t uncompressedSize)
     {
-        std::vector<uint8_t> decompressed(uncompressedSize);
-        uLongf destLen = static_cast<uLongf>(uncompressedSize);
-
-        if (uncompress(decompressed.data(), &destLen, data.data(), static_cast<uLong>(data.size())) != Z_OK)
+        std::vector<uint8_t> decompressed;
+        if (!CodecContext::ForThread().Inflate(data.data(), data.size(), uncompressedSize, decompressed))
         {
             return {};
         }
-
-        decompressed.resize(destLen);
         return decompressed;
     }
 
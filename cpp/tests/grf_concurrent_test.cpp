@@ -0,0 +1,165 @@
+// Leitura concorrente do GRF: várias threads extraem entradas aleatórias do mesmo
+// GrfFile (stream e mapeado) e cada resultado é comparado com o conteúdo original;
+// GetEntry roda junto com as extrações.
+
+#include "test_common.h"
+#include "../src/core/grf.h"
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+
+using namespace autopatch;
+using namespace autopatch::test;
+
+namespace
+{
+
+    constexpr size_t ENTRY_COUNT = 600;
+    constexpr size_t THREAD_COUNT = 16;
+    constexpr size_t READS_PER_THREAD = 3000;
+
+    struct Expected
+    {
+        std::string name;
+        std::vector<uint8_t> data;
+    };
+
+    // Mistura de tamanhos e compressibilidade: vazias, pequenas, texto repetitivo,
+    // aleatórias (gravadas quase sem ganho) e algumas maiores que um bloco de stream
+    std::vector<Expected> MakeEntries()
+    {
+        std::vector<Expected> entries(ENTRY_COUNT);
+        for (size_t i = 0; i < ENTRY_COUNT; i++)
+        {
+            Expected &entry = entries[i];
+            entry.name = "data\\concurrent\\" + std::to_string(i % 7) + "\\file_" + std::to_string(i) + ".bin";
+            switch (i % 5)
+            {
+            case 0:
+                entry.data = RandomBytes(i % 3 == 0 ? 0 : 1 + i % 97, i);
+                break;
+            case 1:
+                for (size_t n = 0; n < 200 + i * 13; n++)
+                {
+                    std::string line = "linha " + std::to_string(n) + " da entrada " + std::to_string(i) + "\n";
+                    entry.data.insert(entry.data.end(), line.begin(), line.end());
+                }
+                break;
+            case 2:
+                entry.data = RandomBytes(4096 + i * 31, i);
+                break;
+            case 3:
+                entry.data = RandomBytes(64 * 1024 + i, i);
+                break;
+            default:
+                entry.data = i % 50 == 4 ? RandomBytes(2 * 1024 * 1024 + i, i) : RandomBytes(300 + i, i);
+                break;
+            }
+        }
+        return entries;
+    }
+
+    bool BuildGrf(const std::filesystem::path &path, const std::vector<Expected> &entries)
+    {
+        GrfFile grf;
+        if (!grf.Create(path.wstring()))
+        {
+            return false;
+        }
+        for (const Expected &entry : entries)
+        {
+            if (!grf.AddFile(entry.name, entry.data))
+            {
+                return false;
+            }
+        }
+        return grf.Save();
+    }
+
+    void ReadConcurrently(const GrfFile &grf, const std::vector<Expected> &entries)
+    {
+        std::atomic<size_t> mismatches{0};
+        std::atomic<size_t> reads{0};
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < THREAD_COUNT; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                uint64_t state = 0x243F6A8885A308D3ull ^ (t + 1);
+                std::vector<uint8_t> buffer;
+                for (size_t n = 0; n < READS_PER_THREAD; n++)
+                {
+                    state ^= state << 13;
+                    state ^= state >> 7;
+                    state ^= state << 17;
+                    const Expected &entry = entries[state % entries.size()];
+
+                    // Alterna as três APIs de leitura (todas const e sem cursor compartilhado)
+                    bool ok = false;
+                    switch ((state >> 32) % 3)
+                    {
+                    case 0:
+                        ok = grf.ExtractFile(entry.name) == entry.data;
+                        break;
+                    case 1:
+                        ok = grf.ExtractInto(entry.name, buffer) && buffer == entry.data;
+                        break;
+                    default:
+                    {
+                        std::span<const uint8_t> view = grf.ExtractView(entry.name, buffer);
+                        ok = view.size() == entry.data.size() &&
+                             std::equal(view.begin(), view.end(), entry.data.begin());
+                        break;
+                    }
+                    }
+                    // GetEntry também é const e não guarda nada no GrfFile
+                    std::optional<GrfEntry> info = grf.GetEntry(entry.name);
+                    ok = ok && info && info->uncompressedSize == entry.data.size();
+                    if (!ok)
+                    {
+                        mismatches++;
+                    }
+                    reads++;
+                }
+            });
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        TEST_CHECK(reads == THREAD_COUNT * READS_PER_THREAD);
+        TEST_CHECK(mismatches == 0);
+    }
+
+    void TestConcurrentExtract(const std::filesystem::path &dir)
+    {
+        std::filesystem::path path = dir / "concurrent.grf";
+        std::vector<Expected> entries = MakeEntries();
+        TEST_REQUIRE(BuildGrf(path, entries));
+
+        {
+            GrfFile grf;
+            TEST_REQUIRE(grf.Open(path.wstring()));
+            TEST_CHECK(grf.GetFileCount() == entries.size());
+            ReadConcurrently(grf, entries);
+        }
+        {
+            GrfFile grf;
+            TEST_REQUIRE(grf.Open(path.wstring(), GrfOpenMode::ReadOnlyMapped));
+            TEST_CHECK(grf.IsMapped());
+            ReadConcurrently(grf, entries);
+        }
+    }
+
+} // namespace
+
+int main()
+{
+    std::filesystem::path dir = TempDir("grf_concurrent_test");
+    TestConcurrentExtract(dir);
+    RemoveDir(dir);
+    return Finish("grf_concurrent_test");
+}
@@ -0,0 +1,174 @@
+// GRF além de 4 GB: leitura de offsets de 32 bits no limite, conversão 0x200 -> 0x300
+// no QuickMerge e offsets de 64 bits depois de reabrir. O arquivo é esparso, então o
+// teste só ocupa em disco os poucos MB de dados reais.
+
+#include "test_common.h"
+#include "../src/core/file_io.h"
+#include "../src/core/grf.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace autopatch;
+using namespace autopatch::test;
+
+namespace
+{
+
+    constexpr uint64_t FOUR_GB = 0x100000000ull;
+    constexpr uint32_t HEADER_SIZE = 46;
+
+    // Entrada gravada à mão logo abaixo de 4 GB (offset relativo ao fim do header)
+    constexpr uint64_t NEAR_OFFSET = FOUR_GB - 2 * 1024 * 1024;
+    const char *const NEAR_NAME = "data\\near_4gb.bin";
+
+    void PutU32(std::vector<uint8_t> &out, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    std::vector<uint8_t> Deflate(const std::vector<uint8_t> &data)
+    {
+        uLongf size = compressBound(static_cast<uLong>(data.size()));
+        std::vector<uint8_t> out(size);
+        if (compress2(out.data(), &size, data.data(), static_cast<uLong>(data.size()), Z_BEST_SPEED) != Z_OK)
+        {
+            return {};
+        }
+        out.resize(size);
+        return out;
+    }
+
+    // GRF 0x200 com uma entrada em NEAR_OFFSET e a tabela logo depois: tudo ainda cabe em
+    // offsets de 32 bits, mas qualquer dado novo no fim passa de 4 GB
+    bool WriteNearLimitGrf(const std::filesystem::path &path, const std::vector<uint8_t> &content)
+    {
+        std::vector<uint8_t> compressed = Deflate(content);
+        if (compressed.empty() || !CreateSparseFile(path))
+        {
+            return false;
+        }
+        uint32_t aligned = static_cast<uint32_t>((compressed.size() + 7) & ~size_t(7));
+        uint64_t tableOffset = NEAR_OFFSET + aligned;
+
+        std::vector<uint8_t> table(NEAR_NAME, NEAR_NAME + strlen(NEAR_NAME) + 1);
+        PutU32(table, static_cast<uint32_t>(compressed.size()));
+        PutU32(table, aligned);
+        PutU32(table, static_cast<uint32_t>(content.size()));
+        table.push_back(GRFFILE_FLAG_FILE);
+        PutU32(table, static_cast<uint32_t>(NEAR_OFFSET));
+
+        std::vector<uint8_t> tableRegion;
+        std::vector<uint8_t> compressedTable = Deflate(table);
+        PutU32(tableRegion, static_cast<uint32_t>(compressedTable.size()));
+        PutU32(tableRegion, static_cast<uint32_t>(table.size()));
+        tableRegion.insert(tableRegion.end(), compressedTable.begin(), compressedTable.end());
+
+        std::vector<uint8_t> header(HEADER_SIZE, 0);
+        memcpy(header.data(), "Master of Magic", 16);
+        uint32_t fields[4] = {static_cast<uint32_t>(tableOffset), 0, 1 + 0 + 7, 0x200};
+        memcpy(header.data() + 30, fields, sizeof(fields));
+
+        File file;
+        return file.Open(path.wstring(), File::Mode::ReadWrite) &&
+               file.WriteAt(0, header.data(), header.size()) &&
+               file.WriteAt(HEADER_SIZE + NEAR_OFFSET, compressed.data(), compressed.size()) &&
+               file.WriteAt(HEADER_SIZE + tableOffset, tableRegion.data(), tableRegion.size());
+    }
+
+    void TestQuickMergePast4Gb(const std::filesystem::path &dir)
+    {
+        std::filesystem::path path = dir / "large.grf";
+        std::vector<uint8_t> nearData = RandomBytes(1024 * 1024, 1);
+        std::vector<uint8_t> pastData = RandomBytes(4 * 1024 * 1024, 2);
+        std::vector<uint8_t> streamedData = RandomBytes(3 * 1024 * 1024 + 123, 3);
+        TEST_REQUIRE(WriteNearLimitGrf(path, nearData));
+
+        // 1. Leitura do 0x200 com a entrada no limite dos 32 bits
+        {
+            GrfFile grf;
+            TEST_REQUIRE(grf.Open(path.wstring()));
+            TEST_CHECK(grf.GetVersion() == GrfVersion::V0x200);
+            std::optional<GrfEntry> entry = grf.GetEntry(NEAR_NAME);
+            TEST_REQUIRE(entry.has_value());
+            TEST_CHECK(entry->offset == NEAR_OFFSET);
+            TEST_CHECK(grf.ExtractFile(NEAR_NAME) == nearData);
+        }
+
+        // 2. QuickMerge que leva o fim dos dados além de 4 GB: o Save converte para 0x300.
+        // Com write-behind a entrada vai para o fim (o intervalo esparso antes de
+        // NEAR_OFFSET é um buraco e seria reaproveitado por um AddFile comum).
+        {
+            GrfFile grf;
+            grf.SetWriteBehind(true);
+            TEST_REQUIRE(grf.Open(path.wstring()));
+            TEST_REQUIRE(grf.AddFile("data\\past_4gb.bin", pastData));
+            TEST_REQUIRE(grf.Save());
+            TEST_CHECK(grf.GetVersion() == GrfVersion::V0x300);
+        }
+        {
+            GrfFile grf;
+            TEST_REQUIRE(grf.Open(path.wstring()));
+            TEST_CHECK(grf.GetVersion() == GrfVersion::V0x300);
+            TEST_CHECK(grf.GetFileCount() == 2);
+            std::optional<GrfEntry> nearEntry = grf.GetEntry(NEAR_NAME);
+            std::optional<GrfEntry> pastEntry = grf.GetEntry("data\\past_4gb.bin");
+            TEST_REQUIRE(nearEntry && pastEntry);
+            TEST_CHECK(nearEntry->offset == NEAR_OFFSET);
+            TEST_CHECK(pastEntry->offset + pastEntry->compressedSizeAligned > FOUR_GB);
+            TEST_CHECK(grf.ExtractFile(NEAR_NAME) == nearData);
+            TEST_CHECK(grf.ExtractFile("data\\past_4gb.bin") == pastData);
+        }
+
+        // 3. QuickMerge num 0x300: AddFile em stream aloca no fim, inteiro acima de 4 GB
+        {
+            GrfFile grf;
+            TEST_REQUIRE(grf.Open(path.wstring()));
+            size_t position = 0;
+            CodecContext::StreamReader read = [&](uint8_t *dst, size_t capacity, size_t &count)
+            {
+                count = std::min(capacity, streamedData.size() - position);
+                memcpy(dst, streamedData.data() + position, count);
+                position += count;
+                return true;
+            };
+            TEST_REQUIRE(grf.AddFile("data\\streamed.bin", read, streamedData.size()));
+            TEST_REQUIRE(grf.Save());
+        }
+        {
+            GrfFile grf;
+            TEST_REQUIRE(grf.Open(path.wstring()));
+            TEST_CHECK(grf.GetVersion() == GrfVersion::V0x300);
+            TEST_CHECK(grf.GetFileCount() == 3);
+            std::optional<GrfEntry> streamed = grf.GetEntry("data\\streamed.bin");
+            TEST_REQUIRE(streamed.has_value());
+            TEST_CHECK(streamed->offset >= FOUR_GB);
+            TEST_CHECK(grf.ExtractFile(NEAR_NAME) == nearData);
+            TEST_CHECK(grf.ExtractFile("data\\past_4gb.bin") == pastData);
+            TEST_CHECK(grf.ExtractFile("data\\streamed.bin") == streamedData);
+        }
+
+        // 4. Leitura mapeada (só em 64 bits: a visão cobre o arquivo inteiro)
+        if constexpr (sizeof(void *) >= 8)
+        {
+            GrfFile grf;
+            TEST_REQUIRE(grf.Open(path.wstring(), GrfOpenMode::ReadOnlyMapped));
+            TEST_CHECK(grf.ExtractFile("data\\past_4gb.bin") == pastData);
+            TEST_CHECK(grf.ExtractFile("data\\streamed.bin") == streamedData);
+        }
+    }
+
+} // namespace
+
+int main()
+{
+    std::filesystem::path dir = TempDir("grf_large_test");
+    TestQuickMergePast4Gb(dir);
+    RemoveDir(dir);
+    return Finish("grf_large_test");
+}
@@ -0,0 +1,89 @@
+// Normalização de nomes GRF: maiúsculas/minúsculas e separadores são ignorados só em
+// caracteres de um byte. Em CP949 (UHC) o segundo byte de um caractere pode cair em
+// 'A'-'Z'/'a'-'z'; nomes que diferem só nesse byte são arquivos distintos.
+
+#include "test_common.h"
+#include "../src/core/grf.h"
+#include "../src/core/grf_table.h"
+#include "../src/core/thor.h"
+#include "../src/core/thor_writer.h"
+
+using namespace autopatch;
+using namespace autopatch::test;
+
+namespace
+{
+
+    // 0x81 0x41 e 0x81 0x61: dois caracteres UHC diferentes (segundo byte 'A' e 'a')
+    const std::string UPPER_TRAIL = "data\\\x81\x41.txt";
+    const std::string LOWER_TRAIL = "data\\\x81\x61.txt";
+
+    void TestNameFunctions()
+    {
+        TEST_CHECK(!GrfNameEquals(UPPER_TRAIL, LOWER_TRAIL));
+        TEST_CHECK(GrfNameCompare(UPPER_TRAIL, LOWER_TRAIL) < 0);
+        TEST_CHECK(GrfNameCompare(LOWER_TRAIL, UPPER_TRAIL) > 0);
+        TEST_CHECK(!GrfNameMatch(UPPER_TRAIL, "data\\\x81\x61*"));
+        TEST_CHECK(GrfNameMatch(UPPER_TRAIL, "DATA/\x81\x41*"));
+        TEST_CHECK(GrfNameMatch(UPPER_TRAIL, "*\x81\x41.TXT"));
+
+        // Caracteres de um byte continuam normalizados, inclusive depois de um caractere UHC
+        TEST_CHECK(GrfNameEquals("Data/\x81\x41Sub\\A.TXT", "data\\\x81\x41sub\\a.txt"));
+        TEST_CHECK(GrfNameHash("Data/\x81\x41Sub\\A.TXT") == GrfNameHash("data\\\x81\x41sub\\a.txt"));
+        TEST_CHECK(GrfNameCompare("Data/\x81\x41Sub", "data\\\x81\x41sub") == 0);
+
+        GrfNameIndex index;
+        bool inserted = false;
+        uint32_t upper = index.FindOrInsert(UPPER_TRAIL, inserted);
+        TEST_CHECK(inserted);
+        uint32_t lower = index.FindOrInsert(LOWER_TRAIL, inserted);
+        TEST_CHECK(inserted && lower != upper);
+        TEST_CHECK(index.Find(UPPER_TRAIL) == upper);
+        TEST_CHECK(index.Find(LOWER_TRAIL) == lower);
+        TEST_CHECK(index.Find("DATA/\x81\x41.TXT") == upper);
+    }
+
+    void TestGrfAndThor(const std::filesystem::path &dir)
+    {
+        std::vector<uint8_t> upperData = RandomBytes(3000, 1);
+        std::vector<uint8_t> lowerData = RandomBytes(3000, 2);
+
+        // THOR com os dois nomes aplicado a um GRF: nenhum sobrescreve o outro
+        std::filesystem::path thorPath = dir / "names.thor";
+        {
+            ThorWriter writer;
+            writer.AddFile(UPPER_TRAIL, upperData);
+            writer.AddFile(LOWER_TRAIL, lowerData);
+            TEST_REQUIRE(writer.Write(thorPath.wstring()));
+        }
+
+        ThorFile thor;
+        TEST_REQUIRE(thor.Open(thorPath.wstring()));
+        TEST_CHECK(thor.GetEntries().size() == 2);
+
+        std::filesystem::path grfPath = dir / "names.grf";
+        {
+            GrfFile grf;
+            TEST_REQUIRE(grf.Create(grfPath.wstring()));
+            TEST_REQUIRE(thor.ApplyTo(grf));
+            TEST_REQUIRE(grf.Save());
+        }
+        thor.Close();
+
+        GrfFile grf;
+        TEST_REQUIRE(grf.Open(grfPath.wstring()));
+        TEST_CHECK(grf.GetFileCount() == 2);
+        TEST_CHECK(grf.ExtractFile(UPPER_TRAIL) == upperData);
+        TEST_CHECK(grf.ExtractFile(LOWER_TRAIL) == lowerData);
+    }
+
+} // namespace
+
+int main()
+{
+    std::filesystem::path dir = TempDir("grf_name_test");
+    TestNameFunctions();
+    TestGrfAndThor(dir);
+    RemoveDir(dir);
+    return Finish("grf_name_test");
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+// Utilitários compartilhados pelos testes do autopatch_core (executáveis de console
+// registrados no CTest: código de saída 0 = passou)
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <winioctl.h>
+#endif
+
+namespace autopatch::test
+{
+
+    inline int g_failures = 0;
+
+#define TEST_CHECK(cond)                                                                   \
+    do                                                                                     \
+    {                                                                                      \
+        if (!(cond))                                                                       \
+        {                                                                                  \
+            std::fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond);        \
+            ::autopatch::test::g_failures++;                                               \
+        }                                                                                  \
+    } while (0)
+
+// Interrompe o teste atual quando o restante depende da condição
+#define TEST_REQUIRE(cond)                                                                 \
+    do                                                                                     \
+    {                                                                                      \
+        if (!(cond))                                                                       \
+        {                                                                                  \
+            std::fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond);        \
+            ::autopatch::test::g_failures++;                                               \
+            return;                                                                        \
+        }                                                                                  \
+    } while (0)
+
+    // Diretório temporário vazio e exclusivo do teste
+    inline std::filesystem::path TempDir(const std::string &name)
+    {
+        std::error_code ec;
+        std::filesystem::path dir = std::filesystem::temp_directory_path(ec) / ("autopatch_" + name);
+        std::filesystem::remove_all(dir, ec);
+        std::filesystem::create_directories(dir, ec);
+        return dir;
+    }
+
+    inline void RemoveDir(const std::filesystem::path &dir)
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    // Dados pseudoaleatórios (não comprimem) e determinísticos por 'seed'
+    inline std::vector<uint8_t> RandomBytes(size_t size, uint64_t seed)
+    {
+        std::vector<uint8_t> data(size);
+        uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+        for (size_t i = 0; i < size; i++)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            data[i] = static_cast<uint8_t>(state >> 24);
+        }
+        return data;
+    }
+
+    // Cria um arquivo vazio. No NTFS ele é marcado como esparso, para que escritas
+    // além do fim não aloquem (nem zerem) o intervalo no meio; em POSIX isso já é o padrão.
+    inline bool CreateSparseFile(const std::filesystem::path &path)
+    {
+#ifdef _WIN32
+        HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                                   CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        DWORD returned = 0;
+        BOOL ok = DeviceIoControl(hFile, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &returned, nullptr);
+        CloseHandle(hFile);
+        return ok != FALSE;
+#else
+        FILE *file = std::fopen(path.c_str(), "wb");
+        if (!file)
+        {
+            return false;
+        }
+        std::fclose(file);
+        return true;
+#endif
+    }
+
+    inline int Finish(const char *name)
+    {
+        if (g_failures)
+        {
+            std::fprintf(stderr, "%s: %d verificação(ões) falharam\n", name, g_failures);
+            return 1;
+        }
+        std::printf("%s: ok\n", name);
+        return 0;
+    }
+
+} // namespace autopatch::test
@@ -0,0 +1,142 @@
+// ThorWriter -> ThorFile: patches gerados de um diretório e de dados em memória são
+// reabertos pelo leitor e cada entrada extraída é comparada com a origem (MultiFile,
+// SingleFile, remoções, entrada em stream maior que a janela e ApplyToDisk).
+
+#include "test_common.h"
+#include "../src/core/thor.h"
+#include "../src/core/thor_writer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+using namespace autopatch;
+using namespace autopatch::test;
+
+namespace
+{
+
+    bool WriteSource(const std::filesystem::path &path, const std::vector<uint8_t> &data)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        return out.good();
+    }
+
+    std::vector<uint8_t> ReadAll(const std::filesystem::path &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    std::vector<uint8_t> TextBytes(size_t size)
+    {
+        std::vector<uint8_t> data;
+        for (size_t n = 0; data.size() < size; n++)
+        {
+            std::string line = "entrada " + std::to_string(n % 1000) + " do patch\n";
+            data.insert(data.end(), line.begin(), line.end());
+        }
+        data.resize(size);
+        return data;
+    }
+
+    void TestMultiFileRoundTrip(const std::filesystem::path &dir)
+    {
+        // Nome interno (como AddDirectory gera) -> conteúdo
+        std::map<std::string, std::vector<uint8_t>> expected = {
+            {"data\\texture\\a.txt", TextBytes(10000)},
+            {"data\\texture\\sub\\random.bin", RandomBytes(50000, 1)},
+            {"data\\empty.txt", {}},
+            {"data\\tiny.txt", {'x'}},
+            // Maior que a janela de 64 MB: comprimida em stream direto no destino
+            {"data\\large.bin", TextBytes(65 * 1024 * 1024 + 17)},
+        };
+
+        std::filesystem::path source = dir / "source";
+        for (const auto &[name, data] : expected)
+        {
+            std::string relative = name.substr(5);
+            std::replace(relative.begin(), relative.end(), '\\', '/');
+            TEST_REQUIRE(WriteSource(source / relative, data));
+        }
+#ifdef _WIN32
+        // Sem representação em CP949: ignorado pelo AddDirectory
+        TEST_REQUIRE(WriteSource(source / std::filesystem::path(L"\U0001F600.txt"), {'?'}));
+#endif
+
+        ThorWriter writer;
+        writer.SetUseGrfMerging(false);
+        TEST_CHECK(writer.AddDirectory(source.wstring(), "data\\") == expected.size());
+        TEST_CHECK(!writer.AddFile("data\\missing.txt", (dir / "missing.txt").wstring()));
+
+        expected["data\\memory.txt"] = TextBytes(3000);
+        writer.AddFile("data\\memory.txt", expected["data\\memory.txt"]);
+        writer.RemoveFile("data\\old.txt");
+
+        std::filesystem::path thorPath = dir / "multi.thor";
+        TEST_REQUIRE(writer.Write(thorPath.wstring(), ThorMode::MultiFile));
+
+        ThorFile thor;
+        TEST_REQUIRE(thor.Open(thorPath.wstring()));
+        TEST_CHECK(thor.GetMode() == ThorMode::MultiFile);
+        TEST_CHECK(!thor.UseGrfMerging());
+        TEST_CHECK(thor.GetEntries().size() == expected.size() + 1);
+
+        size_t removes = 0;
+        std::vector<uint8_t> buffer;
+        for (const ThorEntry &entry : thor.GetEntries())
+        {
+            if ((entry.flags & 0x01) != 0)
+            {
+                TEST_CHECK(entry.filename == "data\\old.txt");
+                removes++;
+                continue;
+            }
+            auto it = expected.find(entry.filename);
+            TEST_REQUIRE(it != expected.end());
+            TEST_CHECK(thor.ExtractInto(entry, buffer) && buffer == it->second);
+        }
+        TEST_CHECK(removes == 1);
+
+        // Extração para disco devolve os arquivos de origem
+        std::filesystem::path outputDir = dir / "applied";
+        TEST_CHECK(thor.ApplyToDisk(outputDir.wstring()));
+        for (const auto &[name, data] : expected)
+        {
+            std::string relative = name;
+            std::replace(relative.begin(), relative.end(), '\\', '/');
+            TEST_CHECK(ReadAll(outputDir / relative) == data);
+        }
+    }
+
+    void TestSingleFileRoundTrip(const std::filesystem::path &dir)
+    {
+        std::vector<uint8_t> data = TextBytes(20000);
+        ThorWriter writer;
+        writer.SetTargetGrf("data.grf");
+        writer.AddFile("data\\single.txt", data);
+
+        std::filesystem::path thorPath = dir / "single.thor";
+        TEST_REQUIRE(writer.Write(thorPath.wstring(), ThorMode::SingleFile));
+
+        ThorFile thor;
+        TEST_REQUIRE(thor.Open(thorPath.wstring()));
+        TEST_CHECK(thor.GetMode() == ThorMode::SingleFile);
+        TEST_CHECK(thor.GetTargetGrf() == "data.grf");
+        TEST_REQUIRE(thor.GetEntries().size() == 1);
+        TEST_CHECK(thor.ExtractFile(thor.GetEntries()[0]) == data);
+    }
+
+} // namespace
+
+int main()
+{
+    std::filesystem::path dir = TempDir("thor_writer_test");
+    TestMultiFileRoundTrip(dir);
+    TestSingleFileRoundTrip(dir);
+    RemoveDir(dir);
+    return Finish("thor_writer_test");
+}